@@ -67,6 +67,26 @@ def run_sim(args, inputfile):
     return list(filter(lambda l: l.startswith("OUTPUT"), stdout.decode().split("\n")))
 
 
+def find_mismatch(output_lines, expected_output_lines):
+    # Return a description of the first difference, or None if they match.
+    if len(output_lines) != len(expected_output_lines):
+        return "      {} OUTPUT lines found, expected {}".format(
+            len(output_lines),
+            len(expected_output_lines),
+        )
+    for i, (found, expected) in enumerate(zip(output_lines, expected_output_lines)):
+        if found != expected:
+            return "\n".join(
+                (
+                    f"      On line {i} found:",
+                    f"        {found}",
+                    "      expected:",
+                    f"        {expected}",
+                )
+            )
+    return None
+
+
 # LRU and LRU_PREFER_CLEAN functionality
 # ======================================================================================
 print(f"{bcolors.BOLD}Checking LRU and LRU_PREFER_CLEAN functionality.{bcolors.ENDC}")
@@ -149,6 +169,51 @@ for infile in sorted(inputs_dir.iterdir()):
         print(f"{bcolors.BOLD}{bcolors.OKGREEN}PASS{bcolors.ENDC}")
 
 
+# DIRTY_AWARE special cases
+# ======================================================================================
+# DIRTY_AWARE:WINDOW:WRITE_COST must reproduce LRU with a window of one line or a free
+# write-back, and LRU_PREFER_CLEAN with the whole set as the window and a write-back
+# that costs more than any clean line.
+print(f"\n{bcolors.BOLD}Checking DIRTY_AWARE special cases.{bcolors.ENDC}")
+
+dirty_aware_i = 1
+for infile in sorted(inputs_dir.iterdir()):
+    for expected_file_path in sorted(expected_dir.glob(f"*-{infile.name}")):
+        file_parts = re.match(
+            rf"(lru|lru_prefer_clean)-(\d+)-(\d+)-(\d+)-{infile.name}",
+            expected_file_path.name,
+        )
+        if not file_parts:
+            continue
+        replacement_policy, cache_size, cache_lines, associativity = file_parts.groups()
+        if replacement_policy == "lru":
+            policies = [f"DIRTY_AWARE:1:{associativity}", f"DIRTY_AWARE:{associativity}:0"]
+        else:
+            policies = [f"DIRTY_AWARE:{associativity}:{associativity}"]
+
+        with open(expected_file_path) as ef:
+            expected_output_lines = [line.strip() for line in ef.readlines()]
+
+        for policy in policies:
+            print(
+                f"  {policy} {cache_size} {cache_lines} {associativity} {infile.name}...",
+                end=" ",
+            )
+            test_number = f"4.{dirty_aware_i}"
+            dirty_aware_i += 1
+            test_name = f"{policy} as {expected_file_path.name}"
+
+            output_lines = run_sim([policy, cache_size, cache_lines, associativity], infile)
+            error_text = find_mismatch(output_lines, expected_output_lines)
+            if error_text:
+                print(f"{bcolors.BOLD}{bcolors.FAIL}FAIL{bcolors.ENDC}")
+                print(error_text)
+                test_results_add(test_number, test_name, error_text, 0)
+            else:
+                print(f"{bcolors.BOLD}{bcolors.OKGREEN}PASS{bcolors.ENDC}")
+                test_results_add(test_number, test_name, "PASS", 1)
+
+
 # RAND functionality
 # ======================================================================================
 print(f"\n{bcolors.BOLD}Checking RAND functionality.{bcolors.ENDC}")
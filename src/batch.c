@@ -0,0 +1,532 @@
+//
+// This file contains the implementation of the `cachesim batch` command.
+//
+// Scheduling: the jobs are sorted by estimated cost (records x associativity)
+// and dealt round-robin to one queue per worker. A worker takes jobs from the
+// front of its own queue, and when it runs dry, steals the front job of the
+// fullest other queue, so the largest remaining jobs always start first.
+//
+
+#include "batch.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <sodium.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory_system.h"
+#include "replacement_policies.h"
+#include "trace.h"
+
+#define BATCH_FIELD_LENGTH 4096
+#define BATCH_OUTPUT_LENGTH 512
+
+// A trace, read into memory once.
+struct batch_trace {
+    char path[BATCH_FIELD_LENGTH];
+    struct trace_record *records;
+    size_t count;
+};
+
+enum batch_check { BATCH_UNCHECKED, BATCH_PASS, BATCH_FAIL };
+
+struct batch_job {
+    int lineno;
+    struct batch_trace *trace;
+    char policy[BATCH_FIELD_LENGTH];
+    size_t cache_size, cache_lines, associativity;
+    char expected[BATCH_FIELD_LENGTH]; // Empty if there is nothing to compare to.
+    uint64_t cost;
+
+    // Filled in by the worker.
+    struct cache_system_stats stats;
+    char output[BATCH_OUTPUT_LENGTH]; // The OUTPUT block.
+    bool failed;
+    enum batch_check check;
+    char mismatch[BATCH_OUTPUT_LENGTH]; // The first differing line, if any.
+};
+
+struct batch_queue {
+    pthread_mutex_t lock;
+    size_t *jobs;
+    size_t head, tail;
+};
+
+struct batch_pool {
+    struct batch_job *jobs;
+    struct batch_queue *queues;
+    size_t num_queues;
+};
+
+struct batch_worker {
+    struct batch_pool *pool;
+    size_t id;
+};
+
+static bool batch_trace_load(struct batch_trace *trace)
+{
+    FILE *in = fopen(trace->path, "r");
+    if (!in) {
+        perror(trace->path);
+        return false;
+    }
+    size_t capacity = 1024;
+    trace->records = malloc(sizeof(struct trace_record) * capacity);
+    trace->count = 0;
+    struct trace_record record = {0, 0};
+    while (trace_read(in, &record)) {
+        if (trace->count == capacity) {
+            capacity *= 2;
+            trace->records = realloc(trace->records, sizeof(struct trace_record) * capacity);
+        }
+        trace->records[trace->count++] = record;
+    }
+    fclose(in);
+    return true;
+}
+
+static void batch_run_job(struct batch_job *job)
+{
+    struct cache_system *cache_system =
+        cache_system_new(job->cache_size / job->cache_lines,
+                         job->cache_lines / job->associativity, job->associativity);
+    cache_system->verbose = false;
+    cache_system->replacement_policy = replacement_policy_new_by_name(
+        job->policy, cache_system->num_sets, cache_system->associativity);
+
+    // The records are split into line accesses at this job's line size.
+    struct batch_trace *trace = job->trace;
+    struct trace_splitter splitter;
+    struct trace_record access;
+    trace_splitter_init(&splitter);
+    for (size_t i = 0; i < trace->count && !job->failed; i++) {
+        trace_splitter_feed(&splitter, cache_system, &trace->records[i]);
+        while (!job->failed && trace_splitter_take(&splitter, cache_system, &access)) {
+            job->failed = cache_system_mem_access(cache_system, access.address, access.rw) != 0;
+        }
+    }
+
+    struct cache_system_stats *stats = &cache_system->stats;
+    job->stats = *stats;
+    snprintf(job->output, sizeof(job->output),
+             "OUTPUT ACCESSES %d\nOUTPUT HITS %d\nOUTPUT MISSES %d\n"
+             "OUTPUT DIRTY EVICTIONS %d\nOUTPUT HIT RATIO %.8f\n",
+             stats->accesses, stats->hits, stats->misses, stats->dirty_evictions,
+             (double)stats->hits / stats->accesses);
+    cache_system_cleanup(cache_system);
+    free(cache_system);
+}
+
+// Compare the OUTPUT lines of the job with those of its expected file.
+static void batch_check_job(struct batch_job *job)
+{
+    FILE *in = fopen(job->expected, "r");
+    if (!in) {
+        snprintf(job->mismatch, sizeof(job->mismatch), "cannot read the expected file");
+        job->check = BATCH_FAIL;
+        return;
+    }
+    job->check = BATCH_PASS;
+    char line[BATCH_OUTPUT_LENGTH];
+    const char *found = job->output;
+    while (job->check == BATCH_PASS && fgets(line, sizeof(line), in)) {
+        if (strncmp(line, "OUTPUT", 6)) {
+            continue;
+        }
+        size_t len = strcspn(line, "\n");
+        if (strncmp(found, line, len) || found[len] != '\n') {
+            snprintf(job->mismatch, sizeof(job->mismatch), "expected \"%.*s\"", (int)len, line);
+            job->check = BATCH_FAIL;
+        }
+        found += strcspn(found, "\n");
+        if (*found) found++;
+    }
+    if (job->check == BATCH_PASS && *found) {
+        snprintf(job->mismatch, sizeof(job->mismatch), "unexpected \"%.*s\"",
+                 (int)strcspn(found, "\n"), found);
+        job->check = BATCH_FAIL;
+    }
+    fclose(in);
+}
+
+// Take the front job of a queue. Returns false if it is empty.
+static bool batch_queue_pop(struct batch_queue *queue, size_t *job)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool found = queue->head < queue->tail;
+    if (found) *job = queue->jobs[queue->head++];
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+// The number of jobs left in a queue.
+static size_t batch_queue_left(struct batch_queue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    size_t left = queue->tail - queue->head;
+    pthread_mutex_unlock(&queue->lock);
+    return left;
+}
+
+static void *batch_worker_run(void *arg)
+{
+    struct batch_worker *worker = arg;
+    struct batch_pool *pool = worker->pool;
+    size_t job;
+    for (;;) {
+        if (!batch_queue_pop(&pool->queues[worker->id], &job)) {
+            // Steal from the queue with the most jobs left. Its size may have
+            // changed by the time it is popped, which is retried.
+            size_t victim = worker->id, most = 0;
+            for (size_t q = 0; q < pool->num_queues; q++) {
+                size_t left = batch_queue_left(&pool->queues[q]);
+                if (left > most) {
+                    most = left;
+                    victim = q;
+                }
+            }
+            if (most == 0) {
+                return NULL;
+            }
+            if (!batch_queue_pop(&pool->queues[victim], &job)) {
+                continue;
+            }
+        }
+        batch_run_job(&pool->jobs[job]);
+        if (pool->jobs[job].expected[0]) {
+            batch_check_job(&pool->jobs[job]);
+        }
+    }
+}
+
+struct batch_order {
+    uint64_t cost;
+    size_t job;
+};
+
+// Largest cost first, then manifest order.
+static int batch_order_compare(const void *a, const void *b)
+{
+    const struct batch_order *x = a, *y = b;
+    if (x->cost != y->cost) return x->cost < y->cost ? 1 : -1;
+    return (x->job > y->job) - (x->job < y->job);
+}
+
+static void batch_json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(out, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", *s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static bool batch_write_json(const char *path, struct batch_job *jobs, size_t count)
+{
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return false;
+    }
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < count; i++) {
+        struct batch_job *job = &jobs[i];
+        fprintf(out, "  {\"trace\": ");
+        batch_json_string(out, job->trace->path);
+        fprintf(out, ", \"policy\": ");
+        batch_json_string(out, job->policy);
+        fprintf(out,
+                ", \"cache_size\": %zu, \"cache_lines\": %zu, \"associativity\": %zu, "
+                "\"accesses\": %d, \"hits\": %d, \"misses\": %d, \"dirty_evictions\": %d, "
+                "\"hit_ratio\": %.8f",
+                job->cache_size, job->cache_lines, job->associativity, job->stats.accesses,
+                job->stats.hits, job->stats.misses, job->stats.dirty_evictions,
+                (double)job->stats.hits / job->stats.accesses);
+        if (job->check != BATCH_UNCHECKED) {
+            fprintf(out, ", \"expected\": ");
+            batch_json_string(out, job->expected);
+            fprintf(out, ", \"match\": %s", job->check == BATCH_PASS ? "true" : "false");
+        }
+        fprintf(out, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(out, "]\n");
+    return fclose(out) == 0;
+}
+
+static bool batch_write_files(const char *dir, struct batch_job *jobs, size_t count)
+{
+    char path[2 * BATCH_FIELD_LENGTH];
+    for (size_t i = 0; i < count; i++) {
+        struct batch_job *job = &jobs[i];
+
+        // Name the file like the expected outputs: policy-size-lines-assoc-trace.
+        const char *trace = strrchr(job->trace->path, '/');
+        trace = trace ? trace + 1 : job->trace->path;
+        int n = snprintf(path, sizeof(path), "%s/", dir);
+        for (const char *p = job->policy; *p && n < (int)sizeof(path) - 1; p++) {
+            path[n++] = (*p >= 'A' && *p <= 'Z') ? *p - 'A' + 'a' : *p == ':' ? '_' : *p;
+        }
+        snprintf(path + n, sizeof(path) - n, "-%zu-%zu-%zu-%s", job->cache_size,
+                 job->cache_lines, job->associativity, trace);
+
+        FILE *out = fopen(path, "w");
+        if (!out) {
+            perror(path);
+            return false;
+        }
+        fputs(job->output, out);
+        if (fclose(out) != 0) {
+            perror(path);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parse the manifest into jobs, loading each distinct trace once.
+static struct batch_job *batch_read_manifest(const char *path, size_t *num_jobs,
+                                             struct batch_trace **traces, size_t *num_traces)
+{
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return NULL;
+    }
+
+    size_t jobs_capacity = 16, traces_capacity = 16;
+    struct batch_job *jobs = malloc(sizeof(struct batch_job) * jobs_capacity);
+    *traces = malloc(sizeof(struct batch_trace) * traces_capacity);
+    *num_jobs = 0;
+    *num_traces = 0;
+
+    // The traces are referenced by index until all of them are loaded, as
+    // the array may move while growing.
+    size_t *job_traces = malloc(sizeof(size_t) * jobs_capacity);
+
+    char line[4 * BATCH_FIELD_LENGTH];
+    char trace_path[BATCH_FIELD_LENGTH], size[32], lines[32], assoc[32];
+    bool ok = true;
+    for (int lineno = 1; ok && fgets(line, sizeof(line), in); lineno++) {
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        if (*num_jobs == jobs_capacity) {
+            jobs_capacity *= 2;
+            jobs = realloc(jobs, sizeof(struct batch_job) * jobs_capacity);
+            job_traces = realloc(job_traces, sizeof(size_t) * jobs_capacity);
+        }
+        struct batch_job *job = &jobs[*num_jobs];
+        memset(job, 0, sizeof(struct batch_job));
+        job->lineno = lineno;
+
+        int fields = sscanf(p, "%4095s %4095s %31s %31s %31s %4095s", trace_path, job->policy,
+                            size, lines, assoc, job->expected);
+        char *geometry[] = {size, lines, assoc};
+        if (fields < 5) {
+            fprintf(stderr, "%s:%d: expected TRACE POLICY CACHE_SIZE CACHE_LINES "
+                            "ASSOCIATIVITY [EXPECTED]\n",
+                    path, lineno);
+            ok = false;
+            break;
+        }
+        if (!cache_system_parse_geometry(geometry, &job->cache_size, &job->cache_lines,
+                                         &job->associativity)) {
+            fprintf(stderr, "%s:%d: invalid cache geometry\n", path, lineno);
+            ok = false;
+            break;
+        }
+
+        // Check the policy name once here rather than in every worker.
+        struct replacement_policy *policy = replacement_policy_new_by_name(
+            job->policy, job->cache_lines / job->associativity, job->associativity);
+        if (!policy) {
+            fprintf(stderr, "%s:%d: unknown replacement policy %s\n", path, lineno,
+                    job->policy);
+            ok = false;
+            break;
+        }
+        (*policy->cleanup)(policy);
+        free(policy);
+
+        size_t t = 0;
+        while (t < *num_traces && strcmp((*traces)[t].path, trace_path)) t++;
+        if (t == *num_traces) {
+            if (*num_traces == traces_capacity) {
+                traces_capacity *= 2;
+                *traces = realloc(*traces, sizeof(struct batch_trace) * traces_capacity);
+            }
+            strcpy((*traces)[t].path, trace_path);
+            if (!batch_trace_load(&(*traces)[t])) {
+                ok = false;
+                break;
+            }
+            (*num_traces)++;
+        }
+        job_traces[(*num_jobs)++] = t;
+    }
+    fclose(in);
+
+    for (size_t i = 0; i < *num_jobs; i++) {
+        jobs[i].trace = &(*traces)[job_traces[i]];
+        jobs[i].cost = (uint64_t)jobs[i].trace->count * jobs[i].associativity;
+    }
+    free(job_traces);
+    if (!ok) {
+        for (size_t t = 0; t < *num_traces; t++) {
+            free((*traces)[t].records);
+        }
+        free(*traces);
+        free(jobs);
+        return NULL;
+    }
+    return jobs;
+}
+
+int batch_main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: cachesim batch MANIFEST [--threads N] [--output-dir DIR | --json FILE]\n");
+        return 1;
+    }
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *output_dir = NULL, *json_path = NULL;
+    for (int i = 2; i < argc; i++) {
+        char *endptr;
+        if (!strcmp("--threads", argv[i]) && i + 1 < argc) {
+            threads = strtol(argv[++i], &endptr, 10);
+            if (threads <= 0 || *endptr != '\0') {
+                fprintf(stderr, "--threads needs a positive number\n");
+                return 1;
+            }
+        } else if (!strcmp("--output-dir", argv[i]) && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (!strcmp("--json", argv[i]) && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+
+    // The RAND policy draws from libsodium in every worker.
+    if (sodium_init() < 0) {
+        fprintf(stderr, "Failed to initialize libsodium\n");
+        return 1;
+    }
+
+    size_t num_jobs, num_traces;
+    struct batch_trace *traces;
+    struct batch_job *jobs = batch_read_manifest(argv[1], &num_jobs, &traces, &num_traces);
+    if (!jobs) {
+        return 1;
+    }
+    printf("%zu jobs on %zu traces, %ld threads\n", num_jobs, num_traces, threads);
+
+    // Deal the jobs, largest first, to the worker queues.
+    struct batch_order *order = malloc(sizeof(struct batch_order) * (num_jobs + 1));
+    for (size_t i = 0; i < num_jobs; i++) {
+        order[i].cost = jobs[i].cost;
+        order[i].job = i;
+    }
+    qsort(order, num_jobs, sizeof(struct batch_order), batch_order_compare);
+
+    struct batch_pool pool = {jobs, malloc(sizeof(struct batch_queue) * threads), threads};
+    for (long t = 0; t < threads; t++) {
+        struct batch_queue *queue = &pool.queues[t];
+        pthread_mutex_init(&queue->lock, NULL);
+        queue->jobs = malloc(sizeof(size_t) * (num_jobs / threads + 1));
+        queue->head = 0;
+        queue->tail = 0;
+    }
+    for (size_t i = 0; i < num_jobs; i++) {
+        struct batch_queue *queue = &pool.queues[i % threads];
+        queue->jobs[queue->tail++] = order[i].job;
+    }
+
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    struct batch_worker *workers = malloc(sizeof(struct batch_worker) * threads);
+    bool *started = malloc(sizeof(bool) * threads);
+    for (long t = 0; t < threads; t++) {
+        workers[t].pool = &pool;
+        workers[t].id = t;
+        started[t] = pthread_create(&tids[t], NULL, batch_worker_run, &workers[t]) == 0;
+    }
+    // A worker that cannot be started runs on this thread: it drains its own
+    // queue, then steals like the others.
+    for (long t = 0; t < threads; t++) {
+        if (!started[t]) {
+            batch_worker_run(&workers[t]);
+        }
+    }
+    for (long t = 0; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        }
+    }
+
+    // Report in manifest order.
+    int status = 0;
+    size_t checked = 0, passed = 0;
+    for (size_t i = 0; i < num_jobs; i++) {
+        struct batch_job *job = &jobs[i];
+        if (job->failed) {
+            fprintf(stderr, "%s:%d: the simulation failed\n", argv[1], job->lineno);
+            status = 1;
+        }
+        if (job->check == BATCH_UNCHECKED) {
+            continue;
+        }
+        checked++;
+        if (job->check == BATCH_PASS) {
+            passed++;
+        } else {
+            printf("FAIL %s:%d %s %s %zu %zu %zu: %s\n", argv[1], job->lineno, job->trace->path,
+                   job->policy, job->cache_size, job->cache_lines, job->associativity,
+                   job->mismatch);
+            status = 1;
+        }
+    }
+
+    if (json_path) {
+        if (!batch_write_json(json_path, jobs, num_jobs)) status = 1;
+    } else if (output_dir) {
+        if (!batch_write_files(output_dir, jobs, num_jobs)) status = 1;
+    } else {
+        for (size_t i = 0; i < num_jobs; i++) {
+            printf("JOB %d %s %s %zu %zu %zu\n%s", jobs[i].lineno, jobs[i].trace->path,
+                   jobs[i].policy, jobs[i].cache_size, jobs[i].cache_lines,
+                   jobs[i].associativity, jobs[i].output);
+        }
+    }
+    if (checked) {
+        printf("%zu of %zu jobs match their expected output\n", passed, checked);
+    }
+
+    for (long t = 0; t < threads; t++) {
+        pthread_mutex_destroy(&pool.queues[t].lock);
+        free(pool.queues[t].jobs);
+    }
+    free(pool.queues);
+    free(tids);
+    free(workers);
+    free(started);
+    free(order);
+    for (size_t t = 0; t < num_traces; t++) {
+        free(traces[t].records);
+    }
+    free(traces);
+    free(jobs);
+    return status;
+}
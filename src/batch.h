@@ -0,0 +1,21 @@
+//
+// This file defines the entrypoint of the `cachesim batch` command, which runs
+// many trace x configuration jobs from a manifest in one process. Every
+// distinct trace is read once and shared by all jobs that use it, and the
+// jobs are spread over a pool of worker threads, largest first.
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+
+// cachesim batch MANIFEST [--threads N] [--output-dir DIR | --json FILE]
+//
+// Each line of the manifest is a job:
+//     TRACE POLICY CACHE_SIZE CACHE_LINES ASSOCIATIVITY [EXPECTED]
+// Lines starting with '#' are ignored. When EXPECTED is given, the job's
+// OUTPUT lines are compared to it.
+//
+// argv[0] is "batch".
+int batch_main(int argc, char **argv);
+
+#endif
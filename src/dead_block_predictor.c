@@ -0,0 +1,163 @@
+//
+// This file contains the implementations for the functions defined in
+// dead_block_predictor.h.
+//
+// The predictor follows the sampling dead-block prediction scheme: a small
+// LRU sampler shadows a few of the cache sets, and every time a sampled line
+// is evicted from the sampler without being reused, the counter for the
+// signature of its last access is incremented. Reuse decrements it. The
+// signature is a hash of the line's region and how many times it has been
+// accessed since it was filled (there is no PC in the traces).
+//
+
+#include "dead_block_predictor.h"
+#include <string.h>
+
+#define DEAD_BLOCK_SIGNATURE_BITS 12
+#define DEAD_BLOCK_COUNTER_MAX 3
+#define DEAD_BLOCK_ACCESS_COUNT_MAX 3
+#define DEAD_BLOCK_SAMPLED_SETS 32
+#define DEAD_BLOCK_BYPASS_TABLE_SIZE 1024
+
+static uint16_t dead_block_signature(struct dead_block_predictor *dbp, uint32_t line_addr,
+                                     uint8_t access_count)
+{
+    uint32_t region = line_addr >> dbp->region_bits;
+    uint32_t h = (region ^ ((uint32_t)access_count << 28)) * 0x9e3779b1;
+    return h >> (32 - DEAD_BLOCK_SIGNATURE_BITS);
+}
+
+static uint32_t dead_block_bypass_slot(uint32_t line_addr)
+{
+    return (line_addr * 0x9e3779b1) >> (32 - 10); // log2(DEAD_BLOCK_BYPASS_TABLE_SIZE)
+}
+
+struct dead_block_predictor *dead_block_predictor_new(uint32_t sets, uint32_t associativity,
+                                                      uint32_t region_bits,
+                                                      enum dead_block_mode mode)
+{
+    struct dead_block_predictor *dbp = malloc(sizeof(struct dead_block_predictor));
+    if (!dbp) {
+        return NULL;
+    }
+    dbp->mode = mode;
+    struct dead_block_stats stats = {0, 0, 0, 0};
+    dbp->stats = stats;
+    dbp->num_sets = sets;
+    dbp->associativity = associativity;
+    dbp->region_bits = region_bits;
+
+    dbp->counters = calloc(1 << DEAD_BLOCK_SIGNATURE_BITS, sizeof(uint8_t));
+    dbp->access_counts = calloc(sets * associativity, sizeof(uint8_t));
+
+    // Sample at most DEAD_BLOCK_SAMPLED_SETS sets, spread evenly over the cache.
+    dbp->sample_stride = sets > DEAD_BLOCK_SAMPLED_SETS ? sets / DEAD_BLOCK_SAMPLED_SETS : 1;
+    uint32_t sampled_sets = (sets + dbp->sample_stride - 1) / dbp->sample_stride;
+    dbp->sampler =
+        calloc(sampled_sets * associativity, sizeof(struct dead_block_sampler_entry));
+
+    // A bypassed line counts as a false positive if it comes back before it
+    // would have been pushed out of a cache of this size.
+    dbp->bypassed = calloc(DEAD_BLOCK_BYPASS_TABLE_SIZE, sizeof(struct dead_block_bypass_entry));
+    dbp->time = 0;
+    dbp->false_positive_window = sets * associativity;
+
+    return dbp;
+}
+
+void dead_block_predictor_cleanup(struct dead_block_predictor *dbp)
+{
+    free(dbp->counters);
+    free(dbp->access_counts);
+    free(dbp->sampler);
+    free(dbp->bypassed);
+}
+
+void dead_block_predictor_train(struct dead_block_predictor *dbp, uint32_t set_idx,
+                                uint32_t line_addr)
+{
+    dbp->time++;
+    if (set_idx % dbp->sample_stride != 0) {
+        return;
+    }
+
+    uint32_t assoc = dbp->associativity;
+    struct dead_block_sampler_entry *set = &dbp->sampler[(set_idx / dbp->sample_stride) * assoc];
+
+    // Look for the line in the sampled set. If it is not there, the victim
+    // is the first invalid entry or, failing that, the LRU entry.
+    uint32_t p = assoc - 1;
+    bool found = false;
+    for (uint32_t i = 0; i < assoc; i++) {
+        if (set[i].valid && set[i].line_addr == line_addr) {
+            p = i;
+            found = true;
+            break;
+        }
+        if (!set[i].valid) {
+            p = i;
+            break;
+        }
+    }
+
+    struct dead_block_sampler_entry entry = set[p];
+    if (found) {
+        // The line was reused, so its last signature did not lead to death.
+        if (dbp->counters[entry.signature] > 0) dbp->counters[entry.signature]--;
+        if (entry.access_count < DEAD_BLOCK_ACCESS_COUNT_MAX) entry.access_count++;
+    } else {
+        // The victim was never touched again after its last access.
+        if (entry.valid && dbp->counters[entry.signature] < DEAD_BLOCK_COUNTER_MAX) {
+            dbp->counters[entry.signature]++;
+        }
+        entry.line_addr = line_addr;
+        entry.access_count = 0;
+        entry.valid = true;
+    }
+    entry.signature = dead_block_signature(dbp, line_addr, entry.access_count);
+
+    // Move the entry to the MRU position.
+    memmove(&set[1], &set[0], p * sizeof(struct dead_block_sampler_entry));
+    set[0] = entry;
+}
+
+bool dead_block_predictor_predict_fill(struct dead_block_predictor *dbp, uint32_t line_addr)
+{
+    return dbp->counters[dead_block_signature(dbp, line_addr, 0)] >= DEAD_BLOCK_COUNTER_MAX;
+}
+
+void dead_block_predictor_fill(struct dead_block_predictor *dbp, uint32_t line_idx)
+{
+    dbp->access_counts[line_idx] = 0;
+}
+
+bool dead_block_predictor_hit(struct dead_block_predictor *dbp, uint32_t line_idx,
+                              uint32_t line_addr)
+{
+    uint8_t *count = &dbp->access_counts[line_idx];
+    if (*count < DEAD_BLOCK_ACCESS_COUNT_MAX) (*count)++;
+    return dbp->counters[dead_block_signature(dbp, line_addr, *count)] >= DEAD_BLOCK_COUNTER_MAX;
+}
+
+void dead_block_predictor_record_bypass(struct dead_block_predictor *dbp, uint32_t line_addr,
+                                        char rw)
+{
+    dbp->stats.bypasses++;
+    if (rw == 'W') dbp->stats.bypassed_writes++;
+
+    struct dead_block_bypass_entry *e = &dbp->bypassed[dead_block_bypass_slot(line_addr)];
+    e->line_addr = line_addr;
+    e->time = dbp->time;
+    e->valid = true;
+}
+
+void dead_block_predictor_check_bypassed(struct dead_block_predictor *dbp, uint32_t line_addr)
+{
+    struct dead_block_bypass_entry *e = &dbp->bypassed[dead_block_bypass_slot(line_addr)];
+    if (e->valid && e->line_addr == line_addr) {
+        if (dbp->time - e->time <= dbp->false_positive_window) {
+            dbp->stats.false_positives++;
+        }
+        e->valid = false;
+    }
+}
@@ -0,0 +1,101 @@
+//
+// This file defines the structs and function signatures for the sampling
+// dead-block predictor. The predictor learns which fills are never re-used
+// before eviction and lets the cache system either bypass those fills or
+// insert them at the LRU position.
+//
+
+#ifndef DEAD_BLOCK_PREDICTOR_H
+#define DEAD_BLOCK_PREDICTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// What the cache system does with a fill that is predicted dead.
+enum dead_block_mode {
+    DEAD_BLOCK_BYPASS,     // Do not allocate the line at all (no-allocate path).
+    DEAD_BLOCK_LRU_INSERT, // Allocate the line, but place it at the LRU position.
+};
+
+// Statistics about the predictor's decisions.
+struct dead_block_stats {
+    uint32_t bypasses;        // Fills that were not allocated
+    uint32_t bypassed_writes; // Bypassed fills that were writes (sent straight to memory)
+    uint32_t lru_insertions;  // Lines placed (or demoted) to the LRU position
+    uint32_t false_positives; // Bypassed lines that were re-referenced soon after
+};
+
+// One entry of the sampler. The sampler is a small LRU tag array that shadows
+// a subset of the cache sets and is used to train the prediction table.
+struct dead_block_sampler_entry {
+    uint32_t line_addr;
+    uint16_t signature;
+    uint8_t access_count;
+    bool valid;
+};
+
+// One entry of the table of recently bypassed lines, used to detect false
+// positives.
+struct dead_block_bypass_entry {
+    uint32_t line_addr;
+    uint32_t time;
+    bool valid;
+};
+
+struct dead_block_predictor {
+    enum dead_block_mode mode;
+    struct dead_block_stats stats;
+
+    // The geometry of the cache that the predictor is attached to.
+    uint32_t num_sets, associativity;
+    uint32_t region_bits; // Line address bits dropped to form the region signature.
+
+    // Table of 2-bit saturating counters indexed by signature.
+    uint8_t *counters;
+
+    // Per-line access counts for the lines resident in the cache, laid out
+    // identically to cache_system->cache_lines.
+    uint8_t *access_counts;
+
+    // The sampler covers every sample_stride-th set. Each sampled set has
+    // `associativity` entries ordered from MRU (index 0) to LRU.
+    uint32_t sample_stride;
+    struct dead_block_sampler_entry *sampler;
+
+    // Recently bypassed lines and the access clock used to age them.
+    struct dead_block_bypass_entry *bypassed;
+    uint32_t time, false_positive_window;
+};
+
+// Create a new dead-block predictor for a cache with the given geometry.
+// `region_bits` is the number of low line address bits that are dropped to
+// form the region part of the signature.
+struct dead_block_predictor *dead_block_predictor_new(uint32_t sets, uint32_t associativity,
+                                                      uint32_t region_bits,
+                                                      enum dead_block_mode mode);
+void dead_block_predictor_cleanup(struct dead_block_predictor *dbp);
+
+// Train the predictor with an access. This must be called once for every
+// access to the cache, before the lookup.
+void dead_block_predictor_train(struct dead_block_predictor *dbp, uint32_t set_idx,
+                                uint32_t line_addr);
+
+// Returns whether a fill of the given line should be treated as dead.
+bool dead_block_predictor_predict_fill(struct dead_block_predictor *dbp, uint32_t line_addr);
+
+// Called when the cache line at the given flat index is filled.
+void dead_block_predictor_fill(struct dead_block_predictor *dbp, uint32_t line_idx);
+
+// Called when the cache line at the given flat index is hit. Returns whether
+// the line is now predicted dead.
+bool dead_block_predictor_hit(struct dead_block_predictor *dbp, uint32_t line_idx,
+                              uint32_t line_addr);
+
+// Record that the given line was bypassed, and check whether a missing line
+// was bypassed recently (a false positive).
+void dead_block_predictor_record_bypass(struct dead_block_predictor *dbp, uint32_t line_addr,
+                                        char rw);
+void dead_block_predictor_check_bypassed(struct dead_block_predictor *dbp, uint32_t line_addr);
+
+#endif
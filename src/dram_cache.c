@@ -0,0 +1,220 @@
+//
+// This file contains the implementations for the functions defined in
+// dram_cache.h.
+//
+
+#include "dram_cache.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "memory_system.h"
+
+#define DRAM_CACHE_VALID 0x8000
+#define DRAM_CACHE_DIRTY 0x4000
+#define DRAM_CACHE_TAG_MASK 0x3fff
+
+struct dram_cache *dram_cache_new(uint64_t size, uint32_t ways,
+                                  enum dram_cache_predictor predictor)
+{
+    uint64_t set_bytes = (uint64_t)DRAM_CACHE_LINE_BYTES * ways;
+    uint64_t sets = ways ? size / set_bytes : 0;
+    if (ways == 0 || size % set_bytes != 0 || sets & (sets - 1)) {
+        fprintf(stderr, "--dram-cache needs a power-of-two number of sets of %u lines of %dB\n",
+                ways, DRAM_CACHE_LINE_BYTES);
+        return NULL;
+    }
+    // With 32-bit addresses, the tags fit in the 14 bits of an entry from
+    // DRAM_CACHE_CHUNK_SETS sets on.
+    if (sets < DRAM_CACHE_CHUNK_SETS || size > ((uint64_t)1 << 32)) {
+        fprintf(stderr, "--dram-cache needs at least %d sets and at most 4 GiB\n",
+                DRAM_CACHE_CHUNK_SETS);
+        return NULL;
+    }
+
+    struct dram_cache *dc = calloc(1, sizeof(struct dram_cache));
+    dc->size = size;
+    dc->ways = ways;
+    dc->num_sets = sets;
+    dc->index_bits = __builtin_ctzll(sets);
+    dc->predictor = predictor;
+    dc->num_chunks = sets / DRAM_CACHE_CHUNK_SETS;
+    dc->chunks = calloc(dc->num_chunks, sizeof(uint16_t *));
+    return dc;
+}
+
+void dram_cache_cleanup(struct dram_cache *dc)
+{
+    for (uint32_t i = 0; i < dc->num_chunks; i++) {
+        free(dc->chunks[i]);
+    }
+    free(dc->chunks);
+}
+
+// Returns the ways of the set, allocating its chunk on first use.
+static uint16_t *dram_cache_set(struct dram_cache *dc, uint32_t set_idx)
+{
+    uint16_t **chunk = &dc->chunks[set_idx / DRAM_CACHE_CHUNK_SETS];
+    if (!*chunk) {
+        *chunk = calloc((size_t)DRAM_CACHE_CHUNK_SETS * dc->ways, sizeof(uint16_t));
+        dc->allocated_chunks++;
+    }
+    return &(*chunk)[(size_t)(set_idx % DRAM_CACHE_CHUNK_SETS) * dc->ways];
+}
+
+// Move way i to the front of the set, and return the new front entry.
+static uint16_t *dram_cache_touch(uint16_t *set, uint32_t i)
+{
+    uint16_t entry = set[i];
+    memmove(&set[1], &set[0], sizeof(uint16_t) * i);
+    set[0] = entry;
+    return &set[0];
+}
+
+// `whole` tells whether a write covers the whole line.
+static void dram_cache_line_access(struct dram_cache *dc, uint32_t line_addr, bool write,
+                                   bool whole)
+{
+    struct dram_cache_stats *s = &dc->stats;
+    uint32_t set_idx = line_addr & (dc->num_sets - 1);
+    uint16_t tag = (line_addr >> dc->index_bits) & DRAM_CACHE_TAG_MASK;
+    uint16_t *set = dram_cache_set(dc, set_idx);
+
+    // The lookup reads every TAD of the way group.
+    s->tad_reads += dc->ways;
+    uint32_t way = 0;
+    while (way < dc->ways && set[way] != (DRAM_CACHE_VALID | tag) &&
+           set[way] != (DRAM_CACHE_VALID | DRAM_CACHE_DIRTY | tag)) {
+        way++;
+    }
+    bool hit = way < dc->ways;
+
+    if (!write) {
+        uint32_t lookup = DRAM_CACHE_CYCLES + (dc->ways - 1) * DRAM_CACHE_BURST_CYCLES;
+        uint8_t *counter = NULL;
+        bool predicted_miss = false;
+        if (dc->predictor != DRAM_PREDICT_NONE) {
+            uint32_t page = line_addr / (4096 / DRAM_CACHE_LINE_BYTES);
+            uint32_t h = dc->predictor == DRAM_PREDICT_PAGE ? (page * 0x9e3779b1u) >> 24 : 0;
+            counter = &dc->counters[h % DRAM_CACHE_PREDICTOR_ENTRIES];
+            predicted_miss = *counter >= 4;
+        }
+        s->reads++;
+        s->predicted_misses += predicted_miss;
+        if (hit) {
+            s->read_hits++;
+            s->read_cycles += lookup;
+            s->serial_read_cycles += lookup;
+            if (predicted_miss) {
+                s->wasted_reads++;
+                s->memory_reads++;
+            }
+            if (counter && *counter > 0) (*counter)--;
+        } else {
+            s->memory_reads++;
+            s->read_cycles += predicted_miss
+                                  ? (lookup > DRAM_MEMORY_CYCLES ? lookup : DRAM_MEMORY_CYCLES)
+                                  : lookup + DRAM_MEMORY_CYCLES;
+            s->serial_read_cycles += lookup + DRAM_MEMORY_CYCLES;
+            s->serialized_misses += !predicted_miss;
+            if (counter && *counter < 7) (*counter)++;
+        }
+    } else {
+        s->writes++;
+        s->write_hits += hit;
+    }
+
+    if (hit) {
+        uint16_t *entry = dram_cache_touch(set, way);
+        if (write) {
+            *entry |= DRAM_CACHE_DIRTY;
+            s->tad_writes++;
+        }
+        return;
+    }
+
+    // Fill the line in place of the least recently used way. A write that
+    // covers the whole line is allocated without reading memory; any other
+    // write needs the rest of the line from memory first.
+    if (write && !whole) {
+        s->write_fills++;
+        s->memory_reads++;
+    }
+    uint16_t victim = set[dc->ways - 1];
+    if ((victim & DRAM_CACHE_VALID) && (victim & DRAM_CACHE_DIRTY)) {
+        s->dirty_evictions++;
+        s->memory_writes++;
+    }
+    set[dc->ways - 1] = DRAM_CACHE_VALID | (write ? DRAM_CACHE_DIRTY : 0) | tag;
+    dram_cache_touch(set, dc->ways - 1);
+    s->tad_writes++;
+}
+
+void dram_cache_access(struct dram_cache *dc, uint32_t address, uint32_t bytes, bool write)
+{
+    uint64_t end = (uint64_t)address + bytes;
+    uint32_t first = address / DRAM_CACHE_LINE_BYTES;
+    uint32_t last = (end - 1) / DRAM_CACHE_LINE_BYTES;
+    for (uint64_t line_addr = first; line_addr <= last; line_addr++) {
+        uint64_t start = line_addr * DRAM_CACHE_LINE_BYTES;
+        bool whole = address <= start && end >= start + DRAM_CACHE_LINE_BYTES;
+        dram_cache_line_access(dc, line_addr, write, whole);
+    }
+}
+
+void dram_cache_forward(struct dram_cache *dc, struct cache_system *upper, uint32_t address,
+                        char rw)
+{
+    struct cache_access_result result = upper->last_access;
+    if (!result.hit) {
+        if (result.line_idx < 0 && rw == 'W') {
+            dram_cache_access(dc, address, 1, true);
+        } else {
+            uint32_t line_addr = cache_system_line_addr(upper, address);
+            dram_cache_access(dc, line_addr * upper->line_size, upper->line_size, false);
+        }
+    }
+    if (result.writeback) {
+        dram_cache_access(dc, result.writeback_addr, upper->line_size, true);
+    }
+}
+
+void dram_cache_print(struct dram_cache *dc)
+{
+    struct dram_cache_stats *s = &dc->stats;
+    printf("OUTPUT DRAM CACHE READS %" PRIu64 "\n", s->reads);
+    printf("OUTPUT DRAM CACHE READ HITS %" PRIu64 "\n", s->read_hits);
+    printf("OUTPUT DRAM CACHE READ HIT RATIO %.8f\n",
+           s->reads ? (double)s->read_hits / s->reads : 0.0);
+    printf("OUTPUT DRAM CACHE WRITES %" PRIu64 "\n", s->writes);
+    printf("OUTPUT DRAM CACHE WRITE HITS %" PRIu64 "\n", s->write_hits);
+    printf("OUTPUT DRAM CACHE WRITE MISS FILLS %" PRIu64 "\n", s->write_fills);
+    printf("OUTPUT DRAM CACHE DIRTY EVICTIONS %" PRIu64 "\n", s->dirty_evictions);
+    if (dc->predictor != DRAM_PREDICT_NONE) {
+        uint64_t correct = s->reads - s->wasted_reads - s->serialized_misses;
+        printf("OUTPUT DRAM CACHE PREDICTED MISSES %" PRIu64 "\n", s->predicted_misses);
+        printf("OUTPUT DRAM CACHE WASTED MEMORY READS %" PRIu64 "\n", s->wasted_reads);
+        printf("OUTPUT DRAM CACHE SERIALIZED MISSES %" PRIu64 "\n", s->serialized_misses);
+        printf("OUTPUT DRAM CACHE PREDICTION ACCURACY %.8f\n",
+               s->reads ? (double)correct / s->reads : 0.0);
+    }
+
+    // Everything read from the TADs but the data of the read hits is the
+    // cost of keeping the tags in DRAM.
+    uint64_t tad_bytes = s->tad_reads * DRAM_CACHE_TAD_BYTES;
+    printf("OUTPUT DRAM CACHE TAD BYTES READ %" PRIu64 "\n", tad_bytes);
+    printf("OUTPUT DRAM CACHE TAD BYTES WRITTEN %" PRIu64 "\n",
+           s->tad_writes * DRAM_CACHE_TAD_BYTES);
+    printf("OUTPUT DRAM CACHE TAG READ OVERHEAD BYTES %" PRIu64 "\n",
+           tad_bytes - s->read_hits * DRAM_CACHE_LINE_BYTES);
+    printf("OUTPUT DRAM CACHE MEMORY BYTES READ %" PRIu64 "\n",
+           s->memory_reads * DRAM_CACHE_LINE_BYTES);
+    printf("OUTPUT DRAM CACHE MEMORY BYTES WRITTEN %" PRIu64 "\n",
+           s->memory_writes * DRAM_CACHE_LINE_BYTES);
+    printf("OUTPUT DRAM CACHE AVERAGE READ LATENCY %.4f CYCLES (SERIAL %.4f)\n",
+           s->reads ? (double)s->read_cycles / s->reads : 0.0,
+           s->reads ? (double)s->serial_read_cycles / s->reads : 0.0);
+    printf("OUTPUT DRAM CACHE TAG STORE %" PRIu64 " OF %" PRIu64 " BYTES ALLOCATED\n",
+           (uint64_t)dc->allocated_chunks * DRAM_CACHE_CHUNK_SETS * dc->ways * sizeof(uint16_t),
+           (uint64_t)dc->num_sets * dc->ways * sizeof(uint16_t));
+}
@@ -0,0 +1,94 @@
+//
+// This file defines the struct and function signatures for the DRAM cache
+// model: a large cache of 64 B lines below the simulated cache, built like
+// the Alloy cache. The tag of every line is stored next to its data in one
+// tag-and-data unit (TAD) of DRAM_CACHE_TAD_BYTES, so a lookup reads whole
+// TADs: one for a direct-mapped cache, or the `ways` TADs of a way group
+// that share a DRAM row. Every lookup is charged the bandwidth of its TADs.
+//
+// A memory access predictor guesses whether each read will miss. A predicted
+// miss starts the memory read in parallel with the DRAM cache lookup, which
+// hides the lookup on a miss but wastes memory bandwidth on a hit; a predicted
+// hit serializes the memory read after the lookup on a miss. The `global`
+// predictor is one saturating counter, and the `page` predictor a table of
+// them indexed by a hash of the 4 KiB page.
+//
+// For caches of hundreds of MB, the tags are 16-bit entries (a 14-bit tag, a
+// valid and a dirty bit) and are allocated lazily, DRAM_CACHE_CHUNK_SETS sets
+// at a time, when a set is first touched. Each set keeps its ways in recency
+// order, most recently used first.
+//
+
+#ifndef DRAM_CACHE_H
+#define DRAM_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct cache_system;
+
+#define DRAM_CACHE_LINE_BYTES 64
+#define DRAM_CACHE_TAD_BYTES 72
+#define DRAM_CACHE_CHUNK_SETS 4096
+#define DRAM_CACHE_PREDICTOR_ENTRIES 256
+
+// Latencies in cycles: a lookup of one TAD, every other TAD of a way group,
+// and main memory.
+#define DRAM_CACHE_CYCLES 40
+#define DRAM_CACHE_BURST_CYCLES 4
+#define DRAM_MEMORY_CYCLES 80
+
+enum dram_cache_predictor {
+    DRAM_PREDICT_NONE, // Always predict a hit: the memory read is serialized.
+    DRAM_PREDICT_GLOBAL,
+    DRAM_PREDICT_PAGE,
+};
+
+struct dram_cache_stats {
+    uint64_t reads, read_hits;
+    uint64_t writes, write_hits;
+    uint64_t write_fills; // Write misses that read the rest of their line from memory
+    uint64_t dirty_evictions;
+
+    // Memory access prediction, for the reads.
+    uint64_t predicted_misses, wasted_reads, serialized_misses;
+
+    uint64_t tad_reads, tad_writes;     // TADs moved between the DRAM cache and the chip
+    uint64_t memory_reads, memory_writes; // Lines moved between the chip and memory
+    uint64_t read_cycles, serial_read_cycles;
+};
+
+struct dram_cache {
+    struct dram_cache_stats stats;
+
+    uint64_t size;
+    uint32_t ways, num_sets, index_bits;
+    enum dram_cache_predictor predictor;
+    uint8_t counters[DRAM_CACHE_PREDICTOR_ENTRIES]; // 3-bit saturating counters
+
+    // chunks[i] holds the ways of sets [i * DRAM_CACHE_CHUNK_SETS, ...), or
+    // is NULL if none of them was touched.
+    uint16_t **chunks;
+    uint32_t num_chunks, allocated_chunks;
+};
+
+// Create a DRAM cache of `size` bytes with `ways` ways per way group. Prints
+// the problem and returns NULL if the geometry is not supported.
+struct dram_cache *dram_cache_new(uint64_t size, uint32_t ways,
+                                  enum dram_cache_predictor predictor);
+void dram_cache_cleanup(struct dram_cache *dc);
+
+// Read (fill) or write back the DRAM cache lines of the given byte range. A
+// write that misses is allocated dirty; unless it covers the whole line, the
+// line is read from memory first.
+void dram_cache_access(struct dram_cache *dc, uint32_t address, uint32_t bytes, bool write);
+
+// Send the requests caused by the last access of `upper` to the DRAM cache,
+// like hierarchy_forward.
+void dram_cache_forward(struct dram_cache *dc, struct cache_system *upper, uint32_t address,
+                        char rw);
+
+void dram_cache_print(struct dram_cache *dc);
+
+#endif
@@ -0,0 +1,92 @@
+//
+// This file contains the implementations for the functions defined in
+// eager_writeback.h.
+//
+
+#include "eager_writeback.h"
+#include "memory_system.h"
+
+struct eager_writeback *eager_writeback_new(uint32_t sets, uint32_t associativity,
+                                            uint32_t interval, uint32_t max_lines)
+{
+    struct eager_writeback *ew = malloc(sizeof(struct eager_writeback));
+    if (!ew) {
+        return NULL;
+    }
+    struct eager_writeback_stats stats = {0, 0, 0};
+    ew->stats = stats;
+    ew->interval = interval;
+    ew->max_lines = max_lines;
+    ew->countdown = interval;
+
+    ew->visited = calloc(sets, sizeof(bool));
+    ew->visited_sets = malloc(sizeof(uint32_t) * sets);
+    ew->num_visited = 0;
+    ew->cleaned = calloc(sets * associativity, sizeof(bool));
+    ew->order = malloc(sizeof(uint32_t) * associativity);
+    return ew;
+}
+
+void eager_writeback_cleanup(struct eager_writeback *ew)
+{
+    free(ew->visited);
+    free(ew->visited_sets);
+    free(ew->cleaned);
+    free(ew->order);
+}
+
+// Write back up to max_lines dirty lines in the set, starting from the LRU
+// end. Policies without a recency order are cleaned in way order.
+static void eager_writeback_clean_set(struct eager_writeback *ew,
+                                      struct cache_system *cache_system, uint32_t set_idx)
+{
+    uint32_t assoc = cache_system->associativity;
+    struct replacement_policy *policy = cache_system->replacement_policy;
+    if (policy->recency_order) {
+        (*policy->recency_order)(policy, cache_system, set_idx, ew->order);
+    } else {
+        for (uint32_t i = 0; i < assoc; i++) {
+            ew->order[i] = i;
+        }
+    }
+
+    uint32_t set_start = set_idx * assoc;
+    uint32_t cleaned = 0;
+    for (uint32_t i = 0; i < assoc && cleaned < ew->max_lines; i++) {
+        struct cache_line *cl = &cache_system->cache_lines[set_start + ew->order[i]];
+        if (cl->status == MODIFIED) {
+            cl->status = EXCLUSIVE;
+            ew->cleaned[set_start + ew->order[i]] = true;
+            ew->stats.writebacks++;
+            cleaned++;
+        }
+    }
+}
+
+void eager_writeback_access(struct eager_writeback *ew, struct cache_system *cache_system,
+                            uint32_t set_idx, uint32_t line_idx, char rw, bool filled)
+{
+    if (filled) {
+        ew->cleaned[line_idx] = false;
+    } else if (rw == 'W' && ew->cleaned[line_idx]) {
+        ew->stats.redirtied++;
+        ew->cleaned[line_idx] = false;
+    }
+
+    if (!ew->visited[set_idx]) {
+        ew->visited[set_idx] = true;
+        ew->visited_sets[ew->num_visited++] = set_idx;
+    }
+
+    if (--ew->countdown > 0) {
+        return;
+    }
+
+    ew->stats.passes++;
+    for (uint32_t i = 0; i < ew->num_visited; i++) {
+        eager_writeback_clean_set(ew, cache_system, ew->visited_sets[i]);
+        ew->visited[ew->visited_sets[i]] = false;
+    }
+    ew->num_visited = 0;
+    ew->countdown = ew->interval;
+}
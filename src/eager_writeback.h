@@ -0,0 +1,56 @@
+//
+// This file defines the struct and function signatures for the eager
+// write-back engine. Every `interval` accesses, the engine visits each set
+// that was accessed since the previous pass and writes back the `max_lines`
+// least-recently used dirty lines in it, turning them from MODIFIED into
+// EXCLUSIVE so that they can later be evicted without a write-back.
+//
+
+#ifndef EAGER_WRITEBACK_H
+#define EAGER_WRITEBACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct cache_system;
+
+// Statistics about the eager write-back engine.
+struct eager_writeback_stats {
+    uint32_t passes;     // Number of times the engine ran
+    uint32_t writebacks; // Dirty lines written back proactively
+    uint32_t redirtied;  // Proactively cleaned lines that were written again
+};
+
+struct eager_writeback {
+    struct eager_writeback_stats stats;
+
+    uint32_t interval;  // Run the engine every `interval` accesses.
+    uint32_t max_lines; // Clean at most this many lines per visited set.
+    uint32_t countdown; // Accesses left until the next pass.
+
+    // The sets accessed since the last pass. visited[set_idx] is true when
+    // set_idx is in visited_sets.
+    bool *visited;
+    uint32_t *visited_sets;
+    uint32_t num_visited;
+
+    // cleaned[i] is true when cache line i was cleaned by the engine and has
+    // not been refilled since.
+    bool *cleaned;
+
+    // Scratch space for one set's recency order.
+    uint32_t *order;
+};
+
+// Create a new eager write-back engine for a cache with the given geometry.
+struct eager_writeback *eager_writeback_new(uint32_t sets, uint32_t associativity,
+                                            uint32_t interval, uint32_t max_lines);
+void eager_writeback_cleanup(struct eager_writeback *ew);
+
+// Called after every access to the cache. `line_idx` is the flat index of the
+// accessed line, and `filled` is whether the access allocated it.
+void eager_writeback_access(struct eager_writeback *ew, struct cache_system *cache_system,
+                            uint32_t set_idx, uint32_t line_idx, char rw, bool filled);
+
+#endif
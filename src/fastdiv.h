@@ -0,0 +1,47 @@
+//
+// This file defines helpers for dividing 32-bit integers by a runtime
+// constant with a multiply and a shift instead of a hardware divide
+// (Lemire et al., "Faster Remainder by Direct Computation"). The results are
+// exact for every 32-bit numerator.
+//
+
+#ifndef FASTDIV_H
+#define FASTDIV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Returns the magic number for dividing by d. d must be at least 2.
+static inline uint64_t fastdiv_magic(uint32_t d)
+{
+    return UINT64_MAX / d + 1;
+}
+
+// Returns n / d, given magic = fastdiv_magic(d).
+static inline uint32_t fastdiv_u32(uint32_t n, uint64_t magic)
+{
+    return (uint32_t)(((__uint128_t)magic * n) >> 64);
+}
+
+// Returns n % d, given magic = fastdiv_magic(d).
+static inline uint32_t fastmod_u32(uint32_t n, uint64_t magic, uint32_t d)
+{
+    uint64_t lowbits = magic * n;
+    return (uint32_t)(((__uint128_t)lowbits * d) >> 64);
+}
+
+static inline bool is_pow2(uint32_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+// Returns the number of bits needed to represent values in [0, n), i.e.
+// ceil(log2(n)).
+static inline uint32_t ceil_log2(uint32_t n)
+{
+    uint32_t bits = 0;
+    while (bits < 32 && ((uint64_t)1 << bits) < n) bits++;
+    return bits;
+}
+
+#endif
@@ -0,0 +1,107 @@
+//
+// This file contains the implementation of the `cachesim filter` command.
+//
+
+#include "filter.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "memory_system.h"
+#include "replacement_policies.h"
+#include "trace.h"
+
+static bool filter_write(FILE *out, uint32_t address, char rw)
+{
+    struct filtered_trace_record r = {address, rw, {0, 0, 0}};
+    return fwrite(&r, sizeof(r), 1, out) == 1;
+}
+
+int filter_main(int argc, char **argv)
+{
+    if (argc != 6) {
+        fprintf(stderr, "Usage: cachesim filter POLICY CACHE_SIZE CACHE_LINES ASSOCIATIVITY "
+                        "OUTPUT_FILE < trace\n");
+        return 1;
+    }
+    char *replacement_policy_str = argv[1];
+    size_t cache_size, cache_lines, associativity;
+    if (!cache_system_parse_geometry(&argv[2], &cache_size, &cache_lines, &associativity)) {
+        return 1;
+    }
+    if (strlen(replacement_policy_str) >= sizeof(((struct filtered_trace_header *)0)->policy)) {
+        fprintf(stderr, "Replacement policy name %s is too long\n", replacement_policy_str);
+        return 1;
+    }
+
+    struct cache_system *cache_system = cache_system_new(
+        cache_size / cache_lines, cache_lines / associativity, associativity);
+    cache_system->verbose = false;
+    cache_system->replacement_policy = replacement_policy_new_by_name(
+        replacement_policy_str, cache_system->num_sets, cache_system->associativity);
+    if (!cache_system->replacement_policy) {
+        fprintf(stderr, "Unknown replacement policy %s\n", replacement_policy_str);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[5], "wb");
+    if (!out) {
+        perror(argv[5]);
+        return 1;
+    }
+
+    // The record count is filled in once the whole trace has been filtered.
+    struct filtered_trace_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILTERED_TRACE_MAGIC, sizeof(header.magic));
+    header.cache_size = cache_size;
+    header.cache_lines = cache_lines;
+    header.associativity = associativity;
+    strcpy(header.policy, replacement_policy_str);
+    fwrite(&header, sizeof(header), 1, out);
+
+    // A miss becomes a read of the line below, and a dirty eviction a write.
+    // Accesses that cross line boundaries are split into one access per line.
+    struct trace_record record = {0, 0};
+    struct trace_splitter splitter;
+    trace_splitter_init(&splitter);
+    bool ok = true;
+    while (ok && trace_split_next(&splitter, stdin, trace_read, cache_system, &record)) {
+        header.accesses++;
+        if (cache_system_mem_access(cache_system, record.address, record.rw) != 0) {
+            return 1;
+        }
+        struct cache_access_result *result = &cache_system->last_access;
+        if (!result->hit) {
+            uint32_t line_addr = cache_system_line_addr(cache_system, record.address);
+            ok = filter_write(out, line_addr * cache_system->line_size, 'R');
+            header.records++;
+        }
+        if (ok && result->writeback) {
+            ok = filter_write(out, result->writeback_addr, 'W');
+            header.records++;
+        }
+    }
+
+    if (ok) {
+        rewind(out);
+        ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    }
+    if (fclose(out) != 0 || !ok) {
+        fprintf(stderr, "Failed to write %s\n", argv[5]);
+        return 1;
+    }
+
+    printf("OUTPUT ACCESSES %d\n", cache_system->stats.accesses);
+    printf("OUTPUT HITS %d\n", cache_system->stats.hits);
+    printf("OUTPUT MISSES %d\n", cache_system->stats.misses);
+    printf("OUTPUT DIRTY EVICTIONS %d\n", cache_system->stats.dirty_evictions);
+    printf("OUTPUT HIT RATIO %.8f\n",
+           (double)cache_system->stats.hits / cache_system->stats.accesses);
+    printf("OUTPUT FILTERED RECORDS %" PRIu64 "\n", header.records);
+    trace_splitter_print(&splitter);
+
+    cache_system_cleanup(cache_system);
+    free(cache_system);
+    return 0;
+}
@@ -0,0 +1,15 @@
+//
+// This file defines the entrypoint of the `cachesim filter` command, which
+// runs an upper-level cache over a trace and writes the requests it sends to
+// the level below as a filtered trace (see trace.h).
+//
+
+#ifndef FILTER_H
+#define FILTER_H
+
+// cachesim filter POLICY CACHE_SIZE CACHE_LINES ASSOCIATIVITY OUTPUT_FILE < trace
+//
+// argv[0] is "filter".
+int filter_main(int argc, char **argv);
+
+#endif
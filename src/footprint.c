@@ -0,0 +1,131 @@
+//
+// This file contains the implementations for the functions defined in
+// footprint.h.
+//
+
+#include "footprint.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// HyperLogLog
+// ============================================================================
+
+void hll_clear(struct hll *hll)
+{
+    memset(hll->registers, 0, sizeof(hll->registers));
+}
+
+void hll_add(struct hll *hll, uint64_t key)
+{
+    // splitmix64 finalizer, so that nearby addresses get unrelated hashes.
+    uint64_t h = key + 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+
+    // The low bits pick the register, the rank is the position of the first
+    // set bit in the rest.
+    uint32_t idx = h & (HLL_REGISTERS - 1);
+    uint64_t rest = h >> HLL_PRECISION;
+    uint8_t rank = rest ? __builtin_ctzll(rest) + 1 : 64 - HLL_PRECISION + 1;
+    if (rank > hll->registers[idx]) hll->registers[idx] = rank;
+}
+
+void hll_merge(struct hll *dst, const struct hll *src)
+{
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        if (src->registers[i] > dst->registers[i]) dst->registers[i] = src->registers[i];
+    }
+}
+
+double hll_estimate(const struct hll *hll)
+{
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hll->registers[i]);
+        zeros += hll->registers[i] == 0;
+    }
+    double m = HLL_REGISTERS;
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+    // Linear counting is more accurate for small cardinalities.
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    return estimate;
+}
+
+// Footprint
+// ============================================================================
+
+struct footprint *footprint_new(uint32_t interval, uint32_t window)
+{
+    struct footprint *fp = malloc(sizeof(struct footprint));
+    if (!fp) {
+        return NULL;
+    }
+    fp->interval = interval;
+    fp->window = window;
+    fp->accesses = 0;
+    fp->hits = 0;
+    fp->intervals = 0;
+    fp->lines = calloc(window, sizeof(struct hll));
+    fp->pages = calloc(window, sizeof(struct hll));
+    hll_clear(&fp->total_lines);
+    hll_clear(&fp->total_pages);
+    return fp;
+}
+
+void footprint_cleanup(struct footprint *fp)
+{
+    free(fp->lines);
+    free(fp->pages);
+}
+
+static void footprint_end_interval(struct footprint *fp)
+{
+    uint32_t slot = fp->intervals % fp->window;
+    struct hll window_lines = fp->lines[slot], window_pages = fp->pages[slot];
+    for (uint32_t i = 0; i < fp->window && i <= fp->intervals; i++) {
+        hll_merge(&window_lines, &fp->lines[(fp->intervals - i) % fp->window]);
+        hll_merge(&window_pages, &fp->pages[(fp->intervals - i) % fp->window]);
+    }
+    hll_merge(&fp->total_lines, &fp->lines[slot]);
+    hll_merge(&fp->total_pages, &fp->pages[slot]);
+
+    printf("OUTPUT INTERVAL %u ACCESSES %u HIT RATIO %.8f LINES %.0f PAGES %.0f WINDOW LINES %.0f "
+           "WINDOW PAGES %.0f\n",
+           fp->intervals, fp->accesses, (double)fp->hits / fp->accesses,
+           hll_estimate(&fp->lines[slot]), hll_estimate(&fp->pages[slot]),
+           hll_estimate(&window_lines), hll_estimate(&window_pages));
+
+    // Start the next interval in the oldest slot of the window.
+    fp->intervals++;
+    hll_clear(&fp->lines[fp->intervals % fp->window]);
+    hll_clear(&fp->pages[fp->intervals % fp->window]);
+    fp->accesses = 0;
+    fp->hits = 0;
+}
+
+void footprint_access(struct footprint *fp, uint32_t address, uint32_t line_addr, bool hit)
+{
+    uint32_t slot = fp->intervals % fp->window;
+    hll_add(&fp->lines[slot], line_addr);
+    hll_add(&fp->pages[slot], address >> FOOTPRINT_PAGE_BITS);
+    fp->accesses++;
+    fp->hits += hit;
+    if (fp->accesses == fp->interval) {
+        footprint_end_interval(fp);
+    }
+}
+
+void footprint_finish(struct footprint *fp)
+{
+    if (fp->accesses > 0) {
+        footprint_end_interval(fp);
+    }
+    printf("OUTPUT FOOTPRINT LINES %.0f PAGES %.0f\n", hll_estimate(&fp->total_lines),
+           hll_estimate(&fp->total_pages));
+}
@@ -0,0 +1,56 @@
+//
+// This file defines the structs and function signatures for the footprint
+// analysis, which estimates the number of distinct lines and pages touched in
+// every interval of accesses, and over a sliding window of intervals, with
+// HyperLogLog sketches.
+//
+
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define HLL_PRECISION 12
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+
+// A HyperLogLog sketch. Sketches of disjoint parts of a trace (intervals, or
+// chunks counted by different threads) are merged by taking the maximum of
+// each register.
+struct hll {
+    uint8_t registers[HLL_REGISTERS];
+};
+
+void hll_clear(struct hll *hll);
+void hll_add(struct hll *hll, uint64_t key);
+void hll_merge(struct hll *dst, const struct hll *src);
+double hll_estimate(const struct hll *hll);
+
+#define FOOTPRINT_PAGE_BITS 12
+
+struct footprint {
+    uint32_t interval; // Accesses per interval.
+    uint32_t window;   // Intervals per sliding window.
+
+    // The current interval.
+    uint32_t accesses, hits, intervals;
+
+    // The line and page sketches of the last `window` intervals (a ring
+    // buffer, the current interval is at intervals % window), and of the
+    // whole trace.
+    struct hll *lines, *pages;
+    struct hll total_lines, total_pages;
+};
+
+struct footprint *footprint_new(uint32_t interval, uint32_t window);
+void footprint_cleanup(struct footprint *fp);
+
+// Record an access. At the end of every interval, a line of the time series
+// is printed.
+void footprint_access(struct footprint *fp, uint32_t address, uint32_t line_addr, bool hit);
+
+// Print the last (partial) interval and the whole-trace footprint.
+void footprint_finish(struct footprint *fp);
+
+#endif
@@ -0,0 +1,246 @@
+//
+// This file contains the implementation of the `cachesim fuzz` command.
+//
+// Every case is checked on each engine of cache_system: single accesses
+// (decoded with the fast division when the geometry is not a power of two),
+// collapsed runs of accesses to the same line, and set-ordered windows.
+// Single accesses are compared with the reference after every access; the
+// other engines reorder or merge accesses, so only their final state is.
+//
+
+#include "fuzz.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory_system.h"
+#include "reference.h"
+#include "replacement_policies.h"
+#include "set_order.h"
+#include "trace.h"
+
+#define FUZZ_MAX_RECORDS 3000
+#define FUZZ_REPRO_PATH "fuzz-repro.trace"
+
+enum fuzz_engine { FUZZ_ACCESS, FUZZ_RUNS, FUZZ_SET_ORDER, FUZZ_ENGINES };
+
+static const char *fuzz_engine_names[FUZZ_ENGINES] = {"single access", "collapsed runs",
+                                                      "set order"};
+
+struct fuzz_case {
+    char policy[40];
+    size_t cache_size, cache_lines, associativity;
+    size_t window; // For the set order engine.
+    struct trace_record *records;
+    size_t count;
+};
+
+// splitmix64, so that a seed always produces the same cases.
+static uint64_t fuzz_next(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static uint32_t fuzz_uniform(uint64_t *state, uint32_t n)
+{
+    return fuzz_next(state) % n;
+}
+
+static void fuzz_generate(struct fuzz_case *c, uint64_t *rng)
+{
+    static const uint32_t line_sizes[] = {1, 2, 4, 8, 16, 32, 64, 3, 12, 24, 48};
+    static const uint32_t associativities[] = {1, 2, 3, 4, 5, 8, 16, 64};
+    uint32_t line_size, sets, assoc;
+    do {
+        line_size = line_sizes[fuzz_uniform(rng, sizeof(line_sizes) / sizeof(uint32_t))];
+        sets = 1 + fuzz_uniform(rng, 40);
+        assoc = associativities[fuzz_uniform(rng, sizeof(associativities) / sizeof(uint32_t))];
+        c->cache_lines = (size_t)sets * assoc;
+        c->cache_size = c->cache_lines * line_size;
+        c->associativity = assoc;
+    } while (cache_system_check_geometry(c->cache_size, c->cache_lines, c->associativity));
+
+    switch (fuzz_uniform(rng, 3)) {
+    case 0:
+        strcpy(c->policy, "LRU");
+        break;
+    case 1:
+        strcpy(c->policy, "LRU_PREFER_CLEAN");
+        break;
+    default:
+        snprintf(c->policy, sizeof(c->policy), "DIRTY_AWARE:%u:%u",
+                 1 + fuzz_uniform(rng, assoc + 1), fuzz_uniform(rng, assoc + 2));
+    }
+    c->window = 1 + fuzz_uniform(rng, 200);
+
+    // Draw from a pool of lines a few times the size of the cache, so that
+    // there are hits, conflicts and evictions, mixed with short strided runs.
+    uint32_t pool = sets * assoc * (1 + fuzz_uniform(rng, 3));
+    uint32_t base = fuzz_next(rng);
+    uint32_t strides[] = {line_size, -line_size, 1, 4};
+    uint32_t address = base;
+    c->count = 1 + fuzz_uniform(rng, FUZZ_MAX_RECORDS);
+    for (size_t i = 0; i < c->count; i++) {
+        if (fuzz_uniform(rng, 10) < 3) {
+            address += strides[fuzz_uniform(rng, 4)];
+        } else {
+            address = base + fuzz_uniform(rng, pool) * line_size + fuzz_uniform(rng, line_size);
+        }
+        struct trace_record record = {fuzz_uniform(rng, 10) < 3 ? 'W' : 'R', address, address};
+        c->records[i] = record;
+    }
+}
+
+// Run one engine and the reference on the case. Returns true if they match.
+static bool fuzz_check(struct fuzz_case *c, enum fuzz_engine engine, char *diff, size_t size)
+{
+    struct cache_system *cache_system =
+        cache_system_new(c->cache_size / c->cache_lines, c->cache_lines / c->associativity,
+                         c->associativity);
+    cache_system->verbose = false;
+    cache_system->replacement_policy = replacement_policy_new_by_name(
+        c->policy, cache_system->num_sets, cache_system->associativity);
+    struct reference_cache *ref =
+        reference_cache_new(c->policy, cache_system->line_size, cache_system->num_sets,
+                            cache_system->associativity);
+
+    bool match = true;
+    struct cache_access_result result;
+    if (engine == FUZZ_ACCESS) {
+        char access_diff[768];
+        for (size_t i = 0; match && i < c->count; i++) {
+            struct trace_record *r = &c->records[i];
+            cache_system_mem_access(cache_system, r->address, r->rw);
+            match = reference_cache_check_access(ref, cache_system, r->address, r->rw,
+                                                 access_diff, sizeof(access_diff));
+            if (!match) {
+                snprintf(diff, size, "at access %zu (%c 0x%x): %s", i + 1, r->rw, r->address,
+                         access_diff);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < c->count; i++) {
+            reference_cache_access(ref, c->records[i].address, c->records[i].rw, &result);
+        }
+    }
+
+    if (engine == FUZZ_RUNS) {
+        for (size_t i = 0, j; i < c->count; i = j) {
+            uint32_t line_addr = cache_system_line_addr(cache_system, c->records[i].address);
+            bool write = false;
+            for (j = i; j < c->count &&
+                        cache_system_line_addr(cache_system, c->records[j].address) == line_addr;
+                 j++) {
+                write |= c->records[j].rw == 'W';
+            }
+            cache_system_mem_access_run(cache_system, line_addr, j - i, write);
+        }
+    } else if (engine == FUZZ_SET_ORDER) {
+        // set_order_run reads a trace file, so give it the text trace.
+        char *text;
+        size_t length;
+        FILE *out = open_memstream(&text, &length);
+        for (size_t i = 0; i < c->count; i++) {
+            fprintf(out, "%c 0x%x\n", c->records[i].rw, c->records[i].address);
+        }
+        fclose(out);
+        FILE *in = fmemopen(text, length, "r");
+        struct trace_splitter splitter;
+        trace_splitter_init(&splitter);
+        set_order_run(cache_system, &splitter, in, trace_read, c->window);
+        fclose(in);
+        free(text);
+    }
+
+    if (match) {
+        match = reference_cache_compare(ref, cache_system, diff, size);
+    }
+
+    reference_cache_cleanup(ref);
+    free(ref);
+    cache_system_cleanup(cache_system);
+    free(cache_system);
+    return match;
+}
+
+// Shrink the trace while the engine still diverges: remove chunks of
+// halving size, keeping each removal that preserves the divergence.
+static void fuzz_minimize(struct fuzz_case *c, enum fuzz_engine engine, char *diff, size_t size)
+{
+    struct trace_record *saved = malloc(sizeof(struct trace_record) * c->count);
+    for (size_t chunk = c->count / 2; chunk >= 1; chunk /= 2) {
+        for (size_t start = 0; start < c->count && c->count > 1;) {
+            size_t end = start + chunk < c->count ? start + chunk : c->count;
+            size_t count = c->count;
+            memcpy(saved, c->records, sizeof(struct trace_record) * count);
+            memmove(&c->records[start], &c->records[end],
+                    sizeof(struct trace_record) * (count - end));
+            c->count = count - (end - start);
+            if (fuzz_check(c, engine, diff, size)) {
+                memcpy(c->records, saved, sizeof(struct trace_record) * count);
+                c->count = count;
+                start = end;
+            }
+        }
+    }
+    free(saved);
+    fuzz_check(c, engine, diff, size); // Leave the diff of the final trace.
+}
+
+int fuzz_main(int argc, char **argv)
+{
+    if (argc > 3) {
+        fprintf(stderr, "Usage: cachesim fuzz [ITERATIONS [SEED]]\n");
+        return 1;
+    }
+    char *endptr = "";
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], &endptr, 10) : 1000;
+    uint64_t seed = 1;
+    if (*endptr == '\0' && argc > 2) seed = strtoull(argv[2], &endptr, 10);
+    if (*endptr != '\0') {
+        fprintf(stderr, "ITERATIONS and SEED must be numbers\n");
+        return 1;
+    }
+
+    struct fuzz_case c;
+    c.records = malloc(sizeof(struct trace_record) * FUZZ_MAX_RECORDS);
+    char diff[1024];
+    uint64_t rng = seed;
+    for (unsigned long i = 0; i < iterations; i++) {
+        fuzz_generate(&c, &rng);
+        for (int engine = 0; engine < FUZZ_ENGINES; engine++) {
+            if (fuzz_check(&c, engine, diff, sizeof(diff))) {
+                continue;
+            }
+
+            printf("Case %lu (seed %" PRIu64 "): the %s engine diverges from the reference\n", i,
+                   seed, fuzz_engine_names[engine]);
+            fuzz_minimize(&c, engine, diff, sizeof(diff));
+            FILE *out = fopen(FUZZ_REPRO_PATH, "w");
+            for (size_t j = 0; out && j < c.count; j++) {
+                fprintf(out, "%c 0x%x\n", c.records[j].rw, c.records[j].address);
+            }
+            if (out) fclose(out);
+            printf("Minimal trace: %zu records in %s\n%s\n", c.count, FUZZ_REPRO_PATH, diff);
+            printf("Reproduce with: ./cachesim %s %zu %zu %zu %s < %s\n", c.policy, c.cache_size,
+                   c.cache_lines, c.associativity,
+                   engine == FUZZ_ACCESS ? "--cross-check"
+                   : engine == FUZZ_RUNS ? "--collapse-runs"
+                                         : "--set-order WINDOW",
+                   FUZZ_REPRO_PATH);
+            if (engine == FUZZ_SET_ORDER) {
+                printf("(WINDOW = %zu)\n", c.window);
+            }
+            free(c.records);
+            return 1;
+        }
+    }
+    printf("%lu cases match the reference (seed %" PRIu64 ")\n", iterations, seed);
+    free(c.records);
+    return 0;
+}
@@ -0,0 +1,18 @@
+//
+// This file defines the entrypoint of the `cachesim fuzz` command, which
+// checks the optimized paths of cache_system against the reference engine
+// (see reference.h) on random cache geometries and synthetic traces.
+//
+
+#ifndef FUZZ_H
+#define FUZZ_H
+
+// cachesim fuzz [ITERATIONS [SEED]]
+//
+// Stops at the first divergence, shrinks the trace to a minimal one that
+// still diverges, and writes it to fuzz-repro.trace.
+//
+// argv[0] is "fuzz".
+int fuzz_main(int argc, char **argv);
+
+#endif
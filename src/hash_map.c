@@ -0,0 +1,86 @@
+//
+// This file contains the implementations for the functions defined in
+// hash_map.h. Collisions are resolved with linear probing, and the table is
+// doubled when it is more than half full.
+//
+
+#include "hash_map.h"
+
+static size_t hash_map_slot(struct hash_map *map, uint64_t key)
+{
+    // Fibonacci hashing; the high bits of the product are the best mixed.
+    uint64_t h = key * 0x9e3779b97f4a7c15ULL;
+    return (size_t)(h ^ (h >> 32)) & (map->capacity - 1);
+}
+
+struct hash_map *hash_map_new(size_t expected)
+{
+    struct hash_map *map = malloc(sizeof(struct hash_map));
+    if (!map) {
+        return NULL;
+    }
+    map->capacity = 16;
+    while (map->capacity < expected * 2) map->capacity *= 2;
+    map->entries = malloc(sizeof(struct hash_map_entry) * map->capacity);
+    map->used = calloc(map->capacity, sizeof(bool));
+    map->count = 0;
+    return map;
+}
+
+void hash_map_cleanup(struct hash_map *map)
+{
+    free(map->entries);
+    free(map->used);
+}
+
+uint64_t *hash_map_get(struct hash_map *map, uint64_t key)
+{
+    for (size_t i = hash_map_slot(map, key);; i = (i + 1) & (map->capacity - 1)) {
+        if (!map->used[i]) {
+            return NULL;
+        }
+        if (map->entries[i].key == key) {
+            return &map->entries[i].value;
+        }
+    }
+}
+
+static void hash_map_grow(struct hash_map *map)
+{
+    struct hash_map_entry *entries = map->entries;
+    bool *used = map->used;
+    size_t capacity = map->capacity;
+
+    map->capacity *= 2;
+    map->entries = malloc(sizeof(struct hash_map_entry) * map->capacity);
+    map->used = calloc(map->capacity, sizeof(bool));
+    for (size_t j = 0; j < capacity; j++) {
+        if (!used[j]) continue;
+        size_t i = hash_map_slot(map, entries[j].key);
+        while (map->used[i]) i = (i + 1) & (map->capacity - 1);
+        map->used[i] = true;
+        map->entries[i] = entries[j];
+    }
+    free(entries);
+    free(used);
+}
+
+uint64_t *hash_map_upsert(struct hash_map *map, uint64_t key, bool *inserted)
+{
+    if ((map->count + 1) * 2 > map->capacity) {
+        hash_map_grow(map);
+    }
+    size_t i = hash_map_slot(map, key);
+    for (; map->used[i]; i = (i + 1) & (map->capacity - 1)) {
+        if (map->entries[i].key == key) {
+            if (inserted) *inserted = false;
+            return &map->entries[i].value;
+        }
+    }
+    map->used[i] = true;
+    map->entries[i].key = key;
+    map->entries[i].value = 0;
+    map->count++;
+    if (inserted) *inserted = true;
+    return &map->entries[i].value;
+}
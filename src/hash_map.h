@@ -0,0 +1,38 @@
+//
+// This file defines a small open-addressing hash map from 64-bit keys to
+// 64-bit values, used by the trace analyses to track per-line and per-page
+// state without a table entry for every possible address.
+//
+
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct hash_map_entry {
+    uint64_t key;
+    uint64_t value;
+};
+
+struct hash_map {
+    struct hash_map_entry *entries;
+    bool *used;
+    size_t capacity; // Always a power of two.
+    size_t count;
+};
+
+// Create a hash map sized for about `expected` keys. It grows as needed.
+struct hash_map *hash_map_new(size_t expected);
+void hash_map_cleanup(struct hash_map *map);
+
+// Returns a pointer to the value for key, or NULL if the key is not present.
+uint64_t *hash_map_get(struct hash_map *map, uint64_t key);
+
+// Returns a pointer to the value for key, inserting it with value 0 if it is
+// not present. `inserted` (if not NULL) is set to whether it was inserted.
+// The pointer is only valid until the next insertion.
+uint64_t *hash_map_upsert(struct hash_map *map, uint64_t key, bool *inserted);
+
+#endif
@@ -0,0 +1,60 @@
+//
+// This file contains the implementations for the functions defined in
+// hierarchy.h.
+//
+
+#include "hierarchy.h"
+#include <stdio.h>
+
+#include "replacement_policies.h"
+
+struct cache_system *hierarchy_cache_new(char **args)
+{
+    size_t cache_size, cache_lines, associativity;
+    if (!cache_system_parse_geometry(&args[1], &cache_size, &cache_lines, &associativity)) {
+        return NULL;
+    }
+    uint32_t sets = cache_lines / associativity;
+    struct replacement_policy *replacement_policy =
+        replacement_policy_new_by_name(args[0], sets, associativity);
+    if (!replacement_policy) {
+        fprintf(stderr, "Unknown replacement policy %s\n", args[0]);
+        return NULL;
+    }
+    struct cache_system *cache_system =
+        cache_system_new(cache_size / cache_lines, sets, associativity);
+    cache_system->verbose = false;
+    cache_system->replacement_policy = replacement_policy;
+    return cache_system;
+}
+
+int hierarchy_forward(struct cache_system *upper, struct cache_system *lower, uint32_t address,
+                      char rw)
+{
+    struct cache_access_result result = upper->last_access;
+    if (!result.hit) {
+        if (result.line_idx < 0 && rw == 'W') {
+            if (cache_system_mem_access(lower, address, 'W') != 0) return 1;
+        } else {
+            uint32_t line_addr = cache_system_line_addr(upper, address);
+            if (cache_system_mem_access(lower, line_addr * upper->line_size, 'R') != 0) {
+                return 1;
+            }
+        }
+    }
+    if (result.writeback) {
+        return cache_system_mem_access(lower, result.writeback_addr, 'W');
+    }
+    return 0;
+}
+
+void hierarchy_print(const char *name, struct cache_system *cache_system)
+{
+    struct cache_system_stats *stats = &cache_system->stats;
+    printf("OUTPUT %s ACCESSES %d\n", name, stats->accesses);
+    printf("OUTPUT %s HITS %d\n", name, stats->hits);
+    printf("OUTPUT %s MISSES %d\n", name, stats->misses);
+    printf("OUTPUT %s DIRTY EVICTIONS %d\n", name, stats->dirty_evictions);
+    printf("OUTPUT %s HIT RATIO %.8f\n", name,
+           stats->accesses ? (double)stats->hits / stats->accesses : 0.0);
+}
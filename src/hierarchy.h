@@ -0,0 +1,27 @@
+//
+// This file defines the helpers for simulating more than one cache: a split
+// L1 with separate instruction and data caches, and a unified lower level
+// that receives the misses and dirty evictions of the L1 caches.
+//
+
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <stdint.h>
+
+#include "memory_system.h"
+
+// Create a cache from POLICY, CACHE_SIZE, CACHE_LINES and ASSOCIATIVITY in
+// args[0..3]. Prints the problem and returns NULL if they are invalid.
+struct cache_system *hierarchy_cache_new(char **args);
+
+// Send the requests caused by the last access of `upper` to `lower`, the same
+// way as `cachesim filter`: a read of the line for a miss, and a write of the
+// evicted line for a dirty eviction. A bypassed write is written through.
+int hierarchy_forward(struct cache_system *upper, struct cache_system *lower, uint32_t address,
+                      char rw);
+
+// Print the statistics of a cache of the hierarchy, prefixed by its name.
+void hierarchy_print(const char *name, struct cache_system *cache_system);
+
+#endif
@@ -0,0 +1,129 @@
+//
+// This file contains the implementations for the functions defined in
+// line_size_sweep.h.
+//
+
+#include "line_size_sweep.h"
+#include <inttypes.h>
+#include "memory_system.h"
+
+struct line_size_sweep *line_size_sweep_new(const char *policy, uint32_t cache_size,
+                                            uint32_t associativity, const uint32_t *line_sizes,
+                                            uint32_t count)
+{
+    struct line_size_sweep *sweep = malloc(sizeof(struct line_size_sweep));
+    if (!sweep) {
+        return NULL;
+    }
+    sweep->count = 0;
+    sweep->caches = calloc(count, sizeof(struct cache_system *));
+    sweep->offset_bits = malloc(sizeof(uint32_t) * count);
+    sweep->tag_shift = malloc(sizeof(uint32_t) * count);
+    sweep->set_mask = malloc(sizeof(uint32_t) * count);
+    sweep->set_idx = malloc(sizeof(uint32_t) * count);
+    sweep->tag = malloc(sizeof(uint32_t) * count);
+    sweep->splitters = malloc(sizeof(struct trace_splitter) * count);
+    sweep->min_line_size = UINT32_MAX;
+    sweep->all_pow2 = true;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t line_size = line_sizes[i];
+        const char *geometry_error =
+            line_size == 0 || cache_size % line_size != 0
+                ? "cache size must be a multiple of the line size"
+                : cache_system_check_geometry(cache_size, cache_size / line_size, associativity);
+        if (geometry_error) {
+            fprintf(stderr, "Invalid cache geometry for line size %u: %s\n", line_size,
+                    geometry_error);
+            line_size_sweep_cleanup(sweep);
+            free(sweep);
+            return NULL;
+        }
+
+        uint32_t sets = cache_size / line_size / associativity;
+        struct cache_system *cs = cache_system_new(line_size, sets, associativity);
+        cs->verbose = false;
+        cs->replacement_policy = replacement_policy_new_by_name(policy, sets, associativity);
+        sweep->caches[sweep->count++] = cs;
+        if (!cs->replacement_policy) {
+            fprintf(stderr, "Unknown replacement policy %s\n", policy);
+            line_size_sweep_cleanup(sweep);
+            free(sweep);
+            return NULL;
+        }
+
+        sweep->offset_bits[i] = cs->offset_bits;
+        sweep->tag_shift[i] = cs->offset_bits + cs->index_bits;
+        sweep->set_mask[i] = sets - 1;
+        trace_splitter_init(&sweep->splitters[i]);
+        if (line_size < sweep->min_line_size) {
+            sweep->min_line_size = line_size;
+        }
+        sweep->all_pow2 = sweep->all_pow2 && cs->line_size_pow2 && cs->num_sets_pow2;
+    }
+    return sweep;
+}
+
+void line_size_sweep_cleanup(struct line_size_sweep *sweep)
+{
+    for (uint32_t i = 0; i < sweep->count; i++) {
+        cache_system_cleanup(sweep->caches[i]);
+        free(sweep->caches[i]);
+    }
+    free(sweep->caches);
+    free(sweep->offset_bits);
+    free(sweep->tag_shift);
+    free(sweep->set_mask);
+    free(sweep->set_idx);
+    free(sweep->tag);
+    free(sweep->splitters);
+}
+
+int line_size_sweep_access(struct line_size_sweep *sweep, const struct trace_record *record)
+{
+    uint32_t address = record->address;
+    uint32_t size = record->size ? record->size : 1;
+
+    // Power-of-two lines nest, so an access that fits in a line of the
+    // smallest size fits in a line of every instance. Decode the address for
+    // every instance first, then run the accesses.
+    if (sweep->all_pow2 && (address & (sweep->min_line_size - 1)) + size <= sweep->min_line_size) {
+        uint64_t a = address;
+        for (uint32_t i = 0; i < sweep->count; i++) {
+            sweep->set_idx[i] = (uint32_t)(a >> sweep->offset_bits[i]) & sweep->set_mask[i];
+            sweep->tag[i] = (uint32_t)(a >> sweep->tag_shift[i]);
+        }
+        for (uint32_t i = 0; i < sweep->count; i++) {
+            if (cache_system_mem_access_decoded(sweep->caches[i], address, sweep->set_idx[i],
+                                                sweep->tag[i], record->rw) != 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Otherwise each instance splits the access at its own line boundaries.
+    for (uint32_t i = 0; i < sweep->count; i++) {
+        struct cache_system *cs = sweep->caches[i];
+        struct trace_record access;
+        trace_splitter_feed(&sweep->splitters[i], cs, record);
+        while (trace_splitter_take(&sweep->splitters[i], cs, &access)) {
+            if (cache_system_mem_access(cs, access.address, access.rw) != 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void line_size_sweep_print(struct line_size_sweep *sweep)
+{
+    for (uint32_t i = 0; i < sweep->count; i++) {
+        struct cache_system *cs = sweep->caches[i];
+        printf("OUTPUT LINE SIZE %u HIT RATIO %.8f BYTES FETCHED %" PRIu64
+               " BYTES WRITTEN BACK %" PRIu64 "\n",
+               cs->line_size, (double)cs->stats.hits / cs->stats.accesses,
+               (uint64_t)cs->stats.misses * cs->line_size,
+               (uint64_t)cs->stats.dirty_evictions * cs->line_size);
+    }
+}
@@ -0,0 +1,50 @@
+//
+// This file defines the struct and function signatures for simulating
+// several caches that differ only in line size from a single pass over the
+// trace.
+//
+
+#ifndef LINE_SIZE_SWEEP_H
+#define LINE_SIZE_SWEEP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "trace.h"
+
+struct cache_system;
+
+struct line_size_sweep {
+    uint32_t count;
+    struct cache_system **caches;
+
+    // Per-instance decode parameters, stored as parallel arrays so that the
+    // decode loop over all of the instances vectorizes. Only used when every
+    // instance has a power-of-two geometry.
+    bool all_pow2;
+    uint32_t *offset_bits, *tag_shift, *set_mask;
+
+    // The decoded set index and tag of the current access for each instance.
+    uint32_t *set_idx, *tag;
+
+    // Splits the accesses that cross a line boundary of an instance, which
+    // is not where the main cache splits them.
+    struct trace_splitter *splitters;
+    uint32_t min_line_size;
+};
+
+// Create caches of `cache_size` bytes and the given associativity for each of
+// the line sizes. Returns NULL (after printing the reason) if one of the
+// geometries is invalid or the policy is unknown.
+struct line_size_sweep *line_size_sweep_new(const char *policy, uint32_t cache_size,
+                                            uint32_t associativity, const uint32_t *line_sizes,
+                                            uint32_t count);
+void line_size_sweep_cleanup(struct line_size_sweep *sweep);
+
+// Feed one record of the trace, before it is split, to all of the caches.
+int line_size_sweep_access(struct line_size_sweep *sweep, const struct trace_record *record);
+
+// Print the hit ratio and traffic of each line size.
+void line_size_sweep_print(struct line_size_sweep *sweep);
+
+#endif
@@ -6,30 +6,287 @@
 // accesses received via stdin.
 //
 
+#include <inttypes.h>
+#include <sodium.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "batch.h"
+#include "dram_cache.h"
+#include "filter.h"
+#include "fuzz.h"
+#include "footprint.h"
+#include "hierarchy.h"
+#include "line_size_sweep.h"
 #include "memory_system.h"
+#include "nuca.h"
+#include "page_locality.h"
+#include "partial_tags.h"
+#include "reference.h"
+#include "region_map.h"
+#include "rand_trials.h"
 #include "replacement_policies.h"
+#include "reuse_distance.h"
+#include "set_order.h"
+#include "statcache.h"
+#include "time_slice.h"
+#include "stream_detector.h"
+#include "trace.h"
+#include "way_predictor.h"
 
 int main(int argc, char **argv)
 {
+    if (argc > 1 && !strcmp("filter", argv[1])) {
+        return filter_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && !strcmp("batch", argv[1])) {
+        return batch_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && !strcmp("fuzz", argv[1])) {
+        return fuzz_main(argc - 1, argv + 1);
+    }
+
     // Parse the arguments.
-    if (argc != 5) {
+    if (argc < 5) {
         fprintf(stderr, "Incorrect number of arguments.\n");
         return 1;
     }
     char *replacement_policy_str = argv[1];
     char *endptr;
-    size_t cache_size = strtol(argv[2], &endptr, 10);
-    size_t cache_lines = strtol(argv[3], &endptr, 10);
-    size_t associativity = strtol(argv[4], &endptr, 10);
+    size_t cache_size, cache_lines, associativity;
+    if (!cache_system_parse_geometry(&argv[2], &cache_size, &cache_lines, &associativity)) {
+        return 1;
+    }
+
+    // Parse the optional arguments.
+    bool dead_block = false;
+    enum dead_block_mode dead_block_mode = DEAD_BLOCK_BYPASS;
+    uint32_t eager_writeback_interval = 0, eager_writeback_lines = 0;
+    uint32_t sweep_line_sizes[32], sweep_count = 0;
+    uint32_t trials = 0;
+    bool collapse_runs = false;
+    const char *filtered_path = NULL;
+    size_t set_order_window = 0;
+    uint32_t reuse_distance_threads = 0;
+    uint32_t footprint_interval = 0, footprint_window = 4;
+    uint32_t page_locality_top = 0;
+    uint32_t stream_entries = 0;
+    char *regions_spec = NULL;
+    bool cross_check = false;
+    uint32_t statcache_period = 0;
+    uint32_t time_slices = 0;
+    size_t time_slice_warmup = 0;
+    char **icache_args = NULL, **l2_args = NULL;
+    uint32_t partial_tag_bits = 0;
+    bool partial_tags_hardware = false;
+    bool way_predict = false;
+    enum way_predictor_mode way_predict_mode = WAY_PREDICT_MRU;
+    uint32_t way_predict_penalty = 1;
+    uint32_t nuca_rows = 0, nuca_cols = 0;
+    enum nuca_hash nuca_hash = NUCA_HASH_MOD;
+    bool nuca_dynamic = false;
+    uint64_t dram_cache_size = 0;
+    uint32_t dram_cache_ways = 0;
+    enum dram_cache_predictor dram_cache_predictor = DRAM_PREDICT_NONE;
+    for (int i = 5; i < argc; i++) {
+        if (!strcmp("--dead-block", argv[i]) && i + 1 < argc) {
+            dead_block = true;
+            i++;
+            if (!strcmp("bypass", argv[i])) {
+                dead_block_mode = DEAD_BLOCK_BYPASS;
+            } else if (!strcmp("lru-insert", argv[i])) {
+                dead_block_mode = DEAD_BLOCK_LRU_INSERT;
+            } else {
+                fprintf(stderr, "Unknown dead-block mode %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp("--eager-writeback", argv[i]) && i + 2 < argc) {
+            long interval = strtol(argv[i + 1], &endptr, 10);
+            bool valid = *endptr == '\0';
+            long lines = strtol(argv[i + 2], &endptr, 10);
+            valid = valid && *endptr == '\0';
+            i += 2;
+            if (!valid || interval <= 0 || interval > UINT32_MAX || lines <= 0 ||
+                lines > UINT32_MAX) {
+                fprintf(stderr, "--eager-writeback needs a positive interval and line count\n");
+                return 1;
+            }
+            eager_writeback_interval = interval;
+            eager_writeback_lines = lines;
+        } else if (!strcmp("--line-sizes", argv[i]) && i + 1 < argc) {
+            // A comma-separated list of line sizes.
+            char *list = argv[++i];
+            while (*list && sweep_count < 32) {
+                sweep_line_sizes[sweep_count++] = strtol(list, &endptr, 10);
+                list = *endptr == ',' ? endptr + 1 : endptr;
+                if (*endptr != ',' && *endptr != '\0') break;
+            }
+            if (*list != '\0') {
+                fprintf(stderr, "Invalid line size list %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp("--trials", argv[i]) && i + 1 < argc) {
+            trials = strtol(argv[++i], &endptr, 10);
+            if (trials == 0 || trials > RAND_TRIALS_MAX || *endptr != '\0') {
+                fprintf(stderr, "--trials needs a number between 1 and %d\n", RAND_TRIALS_MAX);
+                return 1;
+            }
+        } else if (!strcmp("--filtered", argv[i]) && i + 1 < argc) {
+            filtered_path = argv[++i];
+        } else if (!strcmp("--set-order", argv[i]) && i + 1 < argc) {
+            set_order_window = strtol(argv[++i], &endptr, 10);
+            if (set_order_window == 0 || *endptr != '\0') {
+                fprintf(stderr, "--set-order needs a positive window size\n");
+                return 1;
+            }
+        } else if (!strcmp("--reuse-distance", argv[i]) && i + 1 < argc) {
+            reuse_distance_threads = strtol(argv[++i], &endptr, 10);
+            if (reuse_distance_threads == 0 || *endptr != '\0') {
+                fprintf(stderr, "--reuse-distance needs a positive thread count\n");
+                return 1;
+            }
+        } else if (!strcmp("--footprint", argv[i]) && i + 1 < argc) {
+            footprint_interval = strtol(argv[++i], &endptr, 10);
+            if (i + 1 < argc && *argv[i + 1] != '-') {
+                footprint_window = strtol(argv[++i], &endptr, 10);
+            }
+            if (footprint_interval == 0 || footprint_window == 0 || *endptr != '\0') {
+                fprintf(stderr, "--footprint needs a positive interval and window\n");
+                return 1;
+            }
+        } else if (!strcmp("--page-locality", argv[i]) && i + 1 < argc) {
+            page_locality_top = strtol(argv[++i], &endptr, 10);
+            if (page_locality_top == 0 || *endptr != '\0') {
+                fprintf(stderr, "--page-locality needs a positive number of top regions\n");
+                return 1;
+            }
+        } else if (!strcmp("--streams", argv[i]) && i + 1 < argc) {
+            stream_entries = strtol(argv[++i], &endptr, 10);
+            if (stream_entries == 0 || *endptr != '\0') {
+                fprintf(stderr, "--streams needs a positive number of table entries\n");
+                return 1;
+            }
+        } else if (!strcmp("--regions", argv[i]) && i + 1 < argc) {
+            regions_spec = argv[++i];
+        } else if (!strcmp("--cross-check", argv[i])) {
+            cross_check = true;
+        } else if (!strcmp("--statcache", argv[i]) && i + 1 < argc) {
+            statcache_period = strtol(argv[++i], &endptr, 10);
+            if (statcache_period == 0 || *endptr != '\0') {
+                fprintf(stderr, "--statcache needs a positive sampling period\n");
+                return 1;
+            }
+        } else if (!strcmp("--time-slices", argv[i]) && i + 2 < argc) {
+            long count = strtol(argv[++i], &endptr, 10);
+            if (count <= 0 || count > UINT32_MAX || *endptr != '\0') {
+                fprintf(stderr, "--time-slices needs a positive number of slices\n");
+                return 1;
+            }
+            time_slices = count;
+            time_slice_warmup = strtoull(argv[++i], &endptr, 10);
+            if (*endptr != '\0') {
+                fprintf(stderr, "--time-slices needs a number of warmup records\n");
+                return 1;
+            }
+        } else if (!strcmp("--icache", argv[i]) && i + 4 < argc) {
+            icache_args = &argv[i + 1];
+            i += 4;
+        } else if (!strcmp("--l2", argv[i]) && i + 4 < argc) {
+            l2_args = &argv[i + 1];
+            i += 4;
+        } else if (!strcmp("--partial-tags", argv[i]) && i + 1 < argc) {
+            partial_tag_bits = strtol(argv[++i], &endptr, 10);
+            if (partial_tag_bits == 0 || partial_tag_bits > PARTIAL_TAGS_MAX_BITS ||
+                *endptr != '\0') {
+                fprintf(stderr, "--partial-tags needs a number of bits between 1 and %d\n",
+                        PARTIAL_TAGS_MAX_BITS);
+                return 1;
+            }
+            if (i + 1 < argc && !strcmp("hw", argv[i + 1])) {
+                partial_tags_hardware = true;
+                i++;
+            }
+        } else if (!strcmp("--way-predict", argv[i]) && i + 1 < argc) {
+            way_predict = true;
+            i++;
+            if (!strcmp("mru", argv[i])) {
+                way_predict_mode = WAY_PREDICT_MRU;
+            } else if (!strcmp("hash", argv[i])) {
+                way_predict_mode = WAY_PREDICT_HASH;
+            } else {
+                fprintf(stderr, "Unknown way prediction mode %s\n", argv[i]);
+                return 1;
+            }
+            if (i + 1 < argc && *argv[i + 1] != '-') {
+                way_predict_penalty = strtol(argv[++i], &endptr, 10);
+                if (*endptr != '\0') {
+                    fprintf(stderr, "--way-predict needs a number of penalty cycles\n");
+                    return 1;
+                }
+            }
+        } else if (!strcmp("--nuca", argv[i]) && i + 4 < argc) {
+            long rows = strtol(argv[i + 1], &endptr, 10);
+            bool valid = *endptr == '\0';
+            long cols = strtol(argv[i + 2], &endptr, 10);
+            valid = valid && *endptr == '\0';
+            if (!valid || rows <= 0 || rows > UINT32_MAX || cols <= 0 || cols > UINT32_MAX) {
+                fprintf(stderr, "--nuca needs a positive number of rows and columns\n");
+                return 1;
+            }
+            nuca_rows = rows;
+            nuca_cols = cols;
+            if (!strcmp("mod", argv[i + 3])) {
+                nuca_hash = NUCA_HASH_MOD;
+            } else if (!strcmp("xor", argv[i + 3])) {
+                nuca_hash = NUCA_HASH_XOR;
+            } else {
+                fprintf(stderr, "Unknown bank hash %s\n", argv[i + 3]);
+                return 1;
+            }
+            if (!strcmp("static", argv[i + 4])) {
+                nuca_dynamic = false;
+            } else if (!strcmp("dynamic", argv[i + 4])) {
+                nuca_dynamic = true;
+            } else {
+                fprintf(stderr, "Unknown NUCA mode %s\n", argv[i + 4]);
+                return 1;
+            }
+            i += 4;
+        } else if (!strcmp("--dram-cache", argv[i]) && i + 3 < argc) {
+            long long size = strtoll(argv[++i], &endptr, 10);
+            bool valid = *endptr == '\0';
+            long ways = strtol(argv[++i], &endptr, 10);
+            valid = valid && *endptr == '\0';
+            if (!valid || size <= 0 || ways <= 0 || ways > UINT32_MAX) {
+                fprintf(stderr, "--dram-cache needs a positive size and number of ways\n");
+                return 1;
+            }
+            dram_cache_size = size;
+            dram_cache_ways = ways;
+            i++;
+            if (!strcmp("none", argv[i])) {
+                dram_cache_predictor = DRAM_PREDICT_NONE;
+            } else if (!strcmp("global", argv[i])) {
+                dram_cache_predictor = DRAM_PREDICT_GLOBAL;
+            } else if (!strcmp("page", argv[i])) {
+                dram_cache_predictor = DRAM_PREDICT_PAGE;
+            } else {
+                fprintf(stderr, "Unknown DRAM cache predictor %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp("--collapse-runs", argv[i])) {
+            collapse_runs = true;
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
 
     // Calculate the line size and number of sets. DONE
-    int line_size = cache_size / cache_lines;
-    int sets = cache_lines / associativity;
+    uint32_t line_size = cache_size / cache_lines;
+    uint32_t sets = cache_lines / associativity;
 
     // Print out some parameter info
     printf("Parameter Info\n");
@@ -38,38 +295,351 @@ int main(int argc, char **argv)
     printf("Cache Size: %ld\n", cache_size);
     printf("Cache Lines: %ld\n", cache_lines);
     printf("Associativity: %ld\n", associativity);
-    printf("Line Size: %dB\n", line_size);
-    printf("Number of Sets: %d\n", sets);
+    printf("Line Size: %uB\n", line_size);
+    printf("Number of Sets: %u\n", sets);
 
     // Instantiate the cache system.
     struct cache_system *cache_system = cache_system_new(line_size, sets, associativity);
+    cache_system_print_geometry(cache_system);
+
+    // The dead-block predictor is measured against a baseline cache, which
+    // must draw the same random victims: an unseeded RAND gets a random seed
+    // that both caches share.
+    char seeded_policy_str[32];
+    if (dead_block && !strcmp("RAND", replacement_policy_str)) {
+        uint64_t seed;
+        randombytes_buf(&seed, sizeof(seed));
+        snprintf(seeded_policy_str, sizeof(seeded_policy_str), "RAND:%" PRIu64, seed);
+        replacement_policy_str = seeded_policy_str;
+    }
 
     // Instantiate the replacement policy
-    struct replacement_policy *replacement_policy;
-    if (!strcmp("LRU", replacement_policy_str)) {
-        replacement_policy =
-            lru_replacement_policy_new(cache_system->num_sets, cache_system->associativity);
-    } else if (!strcmp("RAND", replacement_policy_str)) {
-        replacement_policy =
-            rand_replacement_policy_new(cache_system->num_sets, cache_system->associativity);
-    } else if (!strcmp("LRU_PREFER_CLEAN", replacement_policy_str)) {
-        replacement_policy = lru_prefer_clean_replacement_policy_new(cache_system->num_sets,
-                                                                     cache_system->associativity);
-    } else {
-        fprintf(stderr, "Unknown replacement policy %s", replacement_policy_str);
+    struct replacement_policy *replacement_policy = replacement_policy_new_by_name(
+        replacement_policy_str, cache_system->num_sets, cache_system->associativity);
+    if (!replacement_policy) {
+        fprintf(stderr, "Unknown replacement policy %s\n", replacement_policy_str);
         return 1;
     }
 
     cache_system->replacement_policy = replacement_policy;
+    if (dead_block && dead_block_mode == DEAD_BLOCK_LRU_INSERT && !replacement_policy->demote) {
+        fprintf(stderr, "--dead-block lru-insert is not supported by the %s policy\n", argv[1]);
+        return 1;
+    }
+
+    if (eager_writeback_interval) {
+        cache_system->eager_writeback =
+            eager_writeback_new(cache_system->num_sets, cache_system->associativity,
+                                eager_writeback_interval, eager_writeback_lines);
+    }
+
+    if (partial_tag_bits) {
+        cache_system->partial_tags =
+            partial_tags_new(cache_system->num_sets, cache_system->associativity,
+                             partial_tag_bits, partial_tags_hardware);
+    }
+
+    if (way_predict) {
+        cache_system->way_predictor =
+            way_predictor_new(cache_system->num_sets, cache_system->associativity,
+                              way_predict_mode, way_predict_penalty);
+    }
+
+    // The RAND trials share the decode of every access with the main cache.
+    struct rand_trials *rand_trials = NULL;
+    if (trials) {
+        uint64_t seed = 0;
+        bool seeded = sscanf(replacement_policy_str, "RAND:%" SCNu64, &seed) == 1;
+        if (!seeded && strcmp("RAND", replacement_policy_str)) {
+            fprintf(stderr, "--trials is only supported with the RAND policy\n");
+            return 1;
+        }
+        rand_trials = rand_trials_new(cache_system->num_sets, cache_system->associativity, trials,
+                                      seeded, seed);
+    }
+
+    // The line size sweep is run on the same accesses, in the same pass.
+    struct line_size_sweep *sweep = NULL;
+    if (sweep_count) {
+        sweep = line_size_sweep_new(replacement_policy_str, cache_size, associativity,
+                                    sweep_line_sizes, sweep_count);
+        if (!sweep) {
+            return 1;
+        }
+    }
+
+    // When the dead-block predictor is enabled, a baseline cache without it is
+    // simulated alongside so that the net effect on the hit ratio is known.
+    struct cache_system *baseline = NULL;
+    if (dead_block) {
+        // Regions are 4 KiB pages.
+        uint32_t region_bits = cache_system->offset_bits < 12 ? 12 - cache_system->offset_bits : 0;
+        cache_system->dead_block_predictor = dead_block_predictor_new(
+            cache_system->num_sets, cache_system->associativity, region_bits, dead_block_mode);
+
+        baseline = cache_system_new(line_size, sets, associativity);
+        baseline->verbose = false;
+        baseline->replacement_policy = replacement_policy_new_by_name(
+            replacement_policy_str, baseline->num_sets, baseline->associativity);
+    }
+
+    // The DRAM cache is below the simulated cache, so it cannot also be below
+    // a split L1 or an L2.
+    struct dram_cache *dram_cache = NULL;
+    if (dram_cache_size) {
+        if (icache_args || l2_args) {
+            fprintf(stderr, "--dram-cache cannot be combined with --icache or --l2\n");
+            return 1;
+        }
+        dram_cache = dram_cache_new(dram_cache_size, dram_cache_ways, dram_cache_predictor);
+        if (!dram_cache) {
+            return 1;
+        }
+    }
+
+    // The banked model of the cache records the accesses and simulates its
+    // banks in parallel after the trace pass.
+    struct nuca *nuca = NULL;
+    if (nuca_rows) {
+        nuca = nuca_new(replacement_policy_str, cache_system->line_size, cache_system->num_sets,
+                        cache_system->associativity, nuca_rows, nuca_cols, nuca_hash,
+                        nuca_dynamic);
+        if (!nuca) {
+            return 1;
+        }
+    }
+
+    // The reuse distance analysis records every line address and runs after
+    // the simulation.
+    struct reuse_distance *reuse_distance = NULL;
+    if (reuse_distance_threads) {
+        reuse_distance = reuse_distance_new();
+    }
+
+    struct statcache *statcache = NULL;
+    if (statcache_period) {
+        statcache = statcache_new(statcache_period);
+    }
+
+    struct footprint *footprint = NULL;
+    if (footprint_interval) {
+        footprint = footprint_new(footprint_interval, footprint_window);
+    }
+
+    struct page_locality *page_locality = NULL;
+    if (page_locality_top) {
+        page_locality = page_locality_new(page_locality_top);
+    }
+
+    struct stream_detector *streams = NULL;
+    if (stream_entries) {
+        streams = stream_detector_new(stream_entries);
+    }
+
+    // The regions are either automatic clusters of the high address bits, or
+    // ranges read from a file.
+    struct region_map *regions = NULL;
+    if (regions_spec) {
+        uint32_t cache_lines = cache_system->num_sets * cache_system->associativity;
+        if (!strncmp(regions_spec, "auto:", 5)) {
+            uint32_t bits = strtol(regions_spec + 5, &endptr, 10);
+            if (bits == 0 || bits > 63 || *endptr != '\0') {
+                fprintf(stderr, "--regions auto:BITS needs BITS between 1 and 63\n");
+                return 1;
+            }
+            regions = region_map_new_clustered(bits, cache_lines);
+        } else if (!(regions = region_map_read(regions_spec, cache_lines))) {
+            return 1;
+        }
+    }
+
+    // The reference engine runs in lockstep with the cache and the first
+    // divergence stops the simulation.
+    struct reference_cache *reference = NULL;
+    if (cross_check) {
+        if (dead_block || eager_writeback_interval || partial_tags_hardware) {
+            fprintf(stderr, "--cross-check cannot be combined with the dead-block predictor, "
+                            "eager write-back or hardware partial tags\n");
+            return 1;
+        }
+        reference = reference_cache_new(replacement_policy_str, cache_system->line_size,
+                                        cache_system->num_sets, cache_system->associativity);
+        if (!reference) {
+            fprintf(stderr, "--cross-check does not support the %s policy\n",
+                    replacement_policy_str);
+            return 1;
+        }
+    }
+    char diff[1024];
 
-    // Read the input and call the cache system mem_access function.
-    char rw = 0;
-    uint32_t address = 0;
-    while (scanf("%c %x\n", &rw, &address) >= 0) {
-        printf("%s at 0x%x\n", (rw == 'R' ? "read" : "write"), address);
-        if (cache_system_mem_access(cache_system, address, rw) != 0) {
+    // With a split L1, the instruction fetches go to their own cache and the
+    // main cache is the D-cache. The L2 is shared by both L1 caches.
+    struct cache_system *icache = NULL, *l2 = NULL;
+    if (icache_args && !(icache = hierarchy_cache_new(icache_args))) {
+        return 1;
+    }
+    if (l2_args && !(l2 = hierarchy_cache_new(l2_args))) {
+        return 1;
+    }
+    if (l2 && (l2->line_size < cache_system->line_size ||
+               (icache && l2->line_size < icache->line_size))) {
+        fprintf(stderr, "warning: the L2 lines are smaller than the L1 lines, so only the first "
+                        "part of every L1 miss is fetched from the L2\n");
+    }
+
+    // The input is either the text trace on stdin, or a filtered trace
+    // produced by `cachesim filter`.
+    FILE *input = stdin;
+    bool (*read_record)(FILE *, struct trace_record *) = trace_read;
+    if (filtered_path) {
+        struct filtered_trace_header header;
+        input = fopen(filtered_path, "rb");
+        if (!input || !trace_filtered_read_header(input, &header)) {
+            fprintf(stderr, "%s is not a filtered trace\n", filtered_path);
             return 1;
         }
+        read_record = trace_filtered_read;
+        printf("Filtered by %s %u %u %u: %" PRIu64 " records from %" PRIu64 " accesses\n",
+               header.policy, header.cache_size, header.cache_lines, header.associativity,
+               header.records, header.accesses);
+
+        // The filtered trace only makes sense below the cache that produced it.
+        uint32_t filter_line_size = header.cache_size / header.cache_lines;
+        if (filter_line_size != line_size) {
+            fprintf(stderr,
+                    "warning: %s was filtered with %uB lines, but this cache has %uB lines\n",
+                    filtered_path, filter_line_size, line_size);
+        }
+        if (header.cache_size >= cache_size) {
+            fprintf(stderr, "warning: %s was filtered by a %u byte cache, which is not smaller "
+                            "than this %zu byte cache\n",
+                    filtered_path, header.cache_size, cache_size);
+        }
+    }
+
+    // Read the input and call the cache system mem_access function. Accesses
+    // that cross line boundaries are split into one access per line.
+    struct trace_record record = {0, 0};
+    struct trace_splitter splitter;
+    trace_splitter_init(&splitter);
+    if (collapse_runs) {
+        // Every access of a run after the first is a guaranteed hit, which
+        // only holds if nothing else acts on individual accesses. Partial
+        // tags count every lookup, and with `hw` may hit another line.
+        if (dead_block || eager_writeback_interval || sweep || rand_trials || filtered_path ||
+            set_order_window || reuse_distance || footprint || page_locality || streams ||
+            regions || reference || statcache || time_slices || icache || l2 || nuca ||
+            dram_cache || partial_tag_bits) {
+            fprintf(stderr, "--collapse-runs cannot be combined with other options\n");
+            return 1;
+        }
+        struct trace_runs *runs = trace_runs_collapse(&splitter, stdin, cache_system);
+        printf("Collapsed %zu accesses into %zu runs\n", runs->accesses, runs->count);
+        for (size_t i = 0; i < runs->count; i++) {
+            struct trace_run *run = &runs->runs[i];
+            printf("%u accesses to line 0x%x\n", run->count, run->line_addr);
+            if (cache_system_mem_access_run(cache_system, run->line_addr, run->count,
+                                            run->write) != 0) {
+                return 1;
+            }
+        }
+        trace_runs_cleanup(runs);
+        free(runs);
+    } else if (time_slices) {
+        // Every slice runs on a fresh copy of the cache, without the engines
+        // and analyses that follow the trace in order.
+        if (dead_block || eager_writeback_interval || sweep || rand_trials || set_order_window ||
+            reuse_distance || footprint || page_locality || streams || regions || reference ||
+            statcache || icache || l2 || partial_tag_bits || way_predict || nuca || dram_cache) {
+            fprintf(stderr, "--time-slices cannot be combined with other options\n");
+            return 1;
+        }
+        if (time_slice_run(cache_system, &splitter, replacement_policy_str, input, read_record,
+                           time_slices, time_slice_warmup) != 0) {
+            return 1;
+        }
+    } else if (set_order_window) {
+        const char *reason = set_order_check(cache_system);
+        if (!reason &&
+            (sweep || rand_trials || reuse_distance || footprint || page_locality || streams ||
+             regions || reference || statcache || icache || l2 || nuca || dram_cache)) {
+            reason = "the line size sweep, lockstep trials, trace analyses and cache hierarchy "
+                     "need trace order";
+        }
+        if (reason) {
+            fprintf(stderr, "--set-order cannot be used: %s\n", reason);
+            return 1;
+        }
+        if (set_order_run(cache_system, &splitter, input, read_record, set_order_window) != 0) {
+            return 1;
+        }
+    } else {
+        while (trace_split_next(&splitter, input, read_record, cache_system, &record)) {
+            char rw = record.rw;
+            uint32_t address = record.address;
+            printf("%s at 0x%x\n", trace_access_name(rw), address);
+            if (icache && rw == 'I') {
+                if (cache_system_mem_access(icache, address, rw) != 0 ||
+                    (l2 && hierarchy_forward(icache, l2, address, rw) != 0)) {
+                    return 1;
+                }
+                continue;
+            }
+            uint32_t set_idx, tag;
+            cache_system_decode(cache_system, address, &set_idx, &tag);
+            if (cache_system_mem_access_decoded(cache_system, address, set_idx, tag, rw) != 0) {
+                return 1;
+            }
+            if (l2 && hierarchy_forward(cache_system, l2, address, rw) != 0) {
+                return 1;
+            }
+            if (dram_cache) {
+                dram_cache_forward(dram_cache, cache_system, address, rw);
+            }
+            if (reference &&
+                !reference_cache_check_access(reference, cache_system, address, rw, diff,
+                                              sizeof(diff))) {
+                printf("OUTPUT CROSS-CHECK DIVERGENCE AT ACCESS %u (%c 0x%x)\n%s\n",
+                       cache_system->stats.accesses, rw, address, diff);
+                return 1;
+            }
+            if (rand_trials) {
+                rand_trials_access(rand_trials, set_idx, tag, rw);
+            }
+            if (baseline && cache_system_mem_access(baseline, address, rw) != 0) {
+                return 1;
+            }
+            // The sweep splits each record at its own line sizes.
+            if (sweep && splitter.first && line_size_sweep_access(sweep, &splitter.whole) != 0) {
+                return 1;
+            }
+            if (nuca) {
+                nuca_add(nuca, cache_system_line_addr(cache_system, address), rw);
+            }
+            if (reuse_distance) {
+                reuse_distance_add(reuse_distance, cache_system_line_addr(cache_system, address));
+            }
+            if (statcache) {
+                statcache_access(statcache, cache_system_line_addr(cache_system, address));
+            }
+            if (footprint) {
+                footprint_access(footprint, address, cache_system_line_addr(cache_system, address),
+                                 cache_system->last_access.hit);
+            }
+            if (page_locality) {
+                page_locality_access(page_locality, record.full_address,
+                                     record.full_address / cache_system->line_size, rw,
+                                     cache_system->last_access.hit);
+            }
+            if (streams) {
+                stream_detector_access(streams, record.full_address);
+            }
+            if (regions) {
+                struct cache_access_result *result = &cache_system->last_access;
+                region_map_access(regions, record.full_address, result->hit, result->writeback,
+                                  result->line_idx);
+            }
+        }
     }
 
     // Print the statistics
@@ -81,8 +651,125 @@ int main(int argc, char **argv)
     printf("OUTPUT DIRTY EVICTIONS %d\n", cache_system->stats.dirty_evictions);
     printf("OUTPUT HIT RATIO %.8f\n",
            (double)cache_system->stats.hits / cache_system->stats.accesses);
+    trace_splitter_print(&splitter);
+
+    if (icache) {
+        hierarchy_print("ICACHE", icache);
+        cache_system_cleanup(icache);
+        free(icache);
+    }
+
+    if (l2) {
+        hierarchy_print("L2", l2);
+        cache_system_cleanup(l2);
+        free(l2);
+    }
+
+    if (reference) {
+        printf("OUTPUT CROSS-CHECK MATCHED %u ACCESSES\n", reference->stats.accesses);
+        reference_cache_cleanup(reference);
+        free(reference);
+    }
+
+    if (regions) {
+        region_map_print(regions);
+        region_map_cleanup(regions);
+        free(regions);
+    }
+
+    if (streams) {
+        stream_detector_print(streams);
+        stream_detector_cleanup(streams);
+        free(streams);
+    }
+
+    if (page_locality) {
+        page_locality_print(page_locality);
+        page_locality_cleanup(page_locality);
+        free(page_locality);
+    }
+
+    if (statcache) {
+        statcache_print(statcache, cache_system->num_sets * cache_system->associativity,
+                        cache_system->line_size);
+        statcache_cleanup(statcache);
+        free(statcache);
+    }
+
+    if (footprint) {
+        footprint_finish(footprint);
+        footprint_cleanup(footprint);
+        free(footprint);
+    }
+
+    if (dram_cache) {
+        dram_cache_print(dram_cache);
+        dram_cache_cleanup(dram_cache);
+        free(dram_cache);
+    }
+
+    if (nuca) {
+        if (nuca_run(nuca) != 0) {
+            return 1;
+        }
+        nuca_print(nuca);
+        nuca_cleanup(nuca);
+        free(nuca);
+    }
+
+    if (reuse_distance) {
+        reuse_distance_compute(reuse_distance, reuse_distance_threads);
+        reuse_distance_print(reuse_distance);
+        reuse_distance_cleanup(reuse_distance);
+        free(reuse_distance);
+    }
+
+    if (rand_trials) {
+        rand_trials_print(rand_trials);
+        rand_trials_cleanup(rand_trials);
+        free(rand_trials);
+    }
+
+    if (sweep) {
+        line_size_sweep_print(sweep);
+        line_size_sweep_cleanup(sweep);
+        free(sweep);
+    }
+
+    if (cache_system->way_predictor) {
+        way_predictor_print(cache_system->way_predictor);
+    }
+
+    if (cache_system->partial_tags) {
+        partial_tags_print(cache_system->partial_tags, cache_system);
+    }
+
+    if (cache_system->eager_writeback) {
+        struct eager_writeback_stats *ews = &cache_system->eager_writeback->stats;
+        printf("OUTPUT EAGER WRITEBACK PASSES %d\n", ews->passes);
+        printf("OUTPUT EAGER WRITEBACKS %d\n", ews->writebacks);
+        printf("OUTPUT EAGER WRITEBACKS REDIRTIED %d\n", ews->redirtied);
+    }
+
+    if (cache_system->dead_block_predictor) {
+        struct dead_block_stats *dbs = &cache_system->dead_block_predictor->stats;
+        double baseline_hit_ratio = (double)baseline->stats.hits / baseline->stats.accesses;
+        printf("OUTPUT DEAD BLOCK BYPASSES %d\n", dbs->bypasses);
+        printf("OUTPUT DEAD BLOCK BYPASSED WRITES %d\n", dbs->bypassed_writes);
+        printf("OUTPUT DEAD BLOCK LRU INSERTIONS %d\n", dbs->lru_insertions);
+        printf("OUTPUT DEAD BLOCK FALSE POSITIVES %d\n", dbs->false_positives);
+        printf("OUTPUT BASELINE HIT RATIO %.8f\n", baseline_hit_ratio);
+        printf("OUTPUT HIT RATIO DELTA %+.8f\n",
+               (double)cache_system->stats.hits / cache_system->stats.accesses -
+                   baseline_hit_ratio);
+        cache_system_cleanup(baseline);
+        free(baseline);
+    }
 
     // Clean everything up.
+    if (input != stdin) {
+        fclose(input);
+    }
     cache_system_cleanup(cache_system);
     free(cache_system);
 
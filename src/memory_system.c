@@ -6,6 +6,45 @@
 #include "memory_system.h"
 #include <math.h>
 
+const char *cache_system_check_geometry(size_t cache_size, size_t cache_lines,
+                                        size_t associativity)
+{
+    if (cache_size == 0 || cache_lines == 0 || associativity == 0) {
+        return "cache size, cache lines and associativity must be positive";
+    }
+    if (cache_size % cache_lines != 0) {
+        return "cache size must be a multiple of the number of cache lines";
+    }
+    if (cache_lines % associativity != 0) {
+        return "number of cache lines must be a multiple of the associativity";
+    }
+    if (cache_size > UINT32_MAX || cache_lines > UINT32_MAX / sizeof(struct cache_line)) {
+        return "cache is too large to simulate with 32-bit addresses";
+    }
+    return NULL;
+}
+
+bool cache_system_parse_geometry(char **args, size_t *cache_size, size_t *cache_lines,
+                                 size_t *associativity)
+{
+    size_t *values[3] = {cache_size, cache_lines, associativity};
+    for (int i = 0; i < 3; i++) {
+        char *endptr;
+        *values[i] = strtol(args[i], &endptr, 10);
+        if (*args[i] == '\0' || *endptr != '\0') {
+            fprintf(stderr, "Invalid number %s\n", args[i]);
+            return false;
+        }
+    }
+    const char *geometry_error = cache_system_check_geometry(*cache_size, *cache_lines,
+                                                             *associativity);
+    if (geometry_error) {
+        fprintf(stderr, "Invalid cache geometry: %s\n", geometry_error);
+        return false;
+    }
+    return true;
+}
+
 struct cache_system *cache_system_new(uint32_t line_size, uint32_t sets, uint32_t associativity)
 {
     struct cache_system *cs = malloc(sizeof(struct cache_system));
@@ -14,21 +53,26 @@ struct cache_system *cache_system_new(uint32_t line_size, uint32_t sets, uint32_
     cs->associativity = associativity;
     struct cache_system_stats stats = {0, 0, 0, 0};
     cs->stats = stats;
+    cs->dead_block_predictor = NULL;
+    cs->eager_writeback = NULL;
+    cs->partial_tags = NULL;
+    cs->way_predictor = NULL;
+    cs->verbose = true;
 
     // Calculate the index bits, offset bits and tag bits. DONE
-    cs->offset_bits = (u_int32_t)log2(line_size);
-    cs->index_bits = (u_int32_t)log2(sets);
+    // For sizes that are not powers of two, these are the number of bits
+    // needed to hold the offset and index, and only used for reporting.
+    cs->offset_bits = ceil_log2(line_size);
+    cs->index_bits = ceil_log2(sets);
     cs->tag_bits = 32 - cs->index_bits - cs->offset_bits;
 
-    cs->offset_mask = 0xffffffff >> (32 - cs->offset_bits);
-    cs->set_index_mask = 0xffffffff >> cs->tag_bits;
+    cs->offset_mask = (uint32_t)(((uint64_t)1 << cs->offset_bits) - 1);
+    cs->set_index_mask = (uint32_t)(((uint64_t)1 << (cs->offset_bits + cs->index_bits)) - 1);
 
-    printf("\nCache System Geometry:\n");
-    printf("Index bits: %d\n", cs->index_bits);
-    printf("Offset bits: %d\n", cs->offset_bits);
-    printf("Tag bits: %d\n", cs->tag_bits);
-    printf("Offset mask: 0x%x\n", cs->offset_mask);
-    printf("Set index mask: 0x%x\n", cs->set_index_mask);
+    cs->line_size_pow2 = is_pow2(line_size);
+    cs->num_sets_pow2 = is_pow2(sets);
+    cs->line_size_magic = cs->line_size_pow2 ? 0 : fastdiv_magic(line_size);
+    cs->num_sets_magic = cs->num_sets_pow2 ? 0 : fastdiv_magic(sets);
 
     // We need to allocate an array of cache lines representing the cache lines
     // across all of the sets in the cache. We are using a single 1-D array
@@ -46,22 +90,76 @@ void cache_system_cleanup(struct cache_system *cache_system)
     free(cache_system->cache_lines);
     cache_system->replacement_policy->cleanup(cache_system->replacement_policy);
     free(cache_system->replacement_policy);
+    if (cache_system->dead_block_predictor) {
+        dead_block_predictor_cleanup(cache_system->dead_block_predictor);
+        free(cache_system->dead_block_predictor);
+    }
+    if (cache_system->eager_writeback) {
+        eager_writeback_cleanup(cache_system->eager_writeback);
+        free(cache_system->eager_writeback);
+    }
+    if (cache_system->partial_tags) {
+        partial_tags_cleanup(cache_system->partial_tags);
+        free(cache_system->partial_tags);
+    }
+    if (cache_system->way_predictor) {
+        way_predictor_cleanup(cache_system->way_predictor);
+        free(cache_system->way_predictor);
+    }
+}
+
+void cache_system_print_geometry(struct cache_system *cs)
+{
+    printf("\nCache System Geometry:\n");
+    printf("Index bits: %d\n", cs->index_bits);
+    printf("Offset bits: %d\n", cs->offset_bits);
+    printf("Tag bits: %d\n", cs->tag_bits);
+    printf("Offset mask: 0x%x\n", cs->offset_mask);
+    printf("Set index mask: 0x%x\n", cs->set_index_mask);
 }
 
 int cache_system_mem_access(struct cache_system *cache_system, uint32_t address, char rw)
+{
+    uint32_t set_idx, tag;
+    cache_system_decode(cache_system, address, &set_idx, &tag);
+    return cache_system_mem_access_decoded(cache_system, address, set_idx, tag, rw);
+}
+
+int cache_system_mem_access_decoded(struct cache_system *cache_system, uint32_t address,
+                                    uint32_t set_idx, uint32_t tag, char rw)
 {
     cache_system->stats.accesses++;
+    struct cache_access_result result = {false, false, 0, -1};
+    cache_system->last_access = result;
 
-    uint32_t offset = (address & cache_system->offset_mask);
-    uint32_t set_idx = (address & cache_system->set_index_mask) >> cache_system->offset_bits;
-    uint32_t tag = address >> (cache_system->offset_bits + cache_system->index_bits);
+    struct dead_block_predictor *dbp = cache_system->dead_block_predictor;
+    uint32_t line_addr = cache_system_line_addr(cache_system, address);
+    if (dbp) dead_block_predictor_train(dbp, set_idx, line_addr);
 
     struct cache_line *cl = cache_system_find_cache_line(cache_system, set_idx, tag);
+    bool predicted_dead = false;
+    bool filled = false;
 
     if (cl == NULL || cl->status == INVALID) { // cache miss
-        printf("  0x%x miss\n", address);
+        if (cache_system->verbose) printf("  0x%x miss\n", address);
         cache_system->stats.misses++;
 
+        if (dbp) {
+            dead_block_predictor_check_bypassed(dbp, line_addr);
+            predicted_dead = dead_block_predictor_predict_fill(dbp, line_addr);
+
+            // No-allocate path: the access goes straight to memory and the set
+            // and the replacement policy are left untouched.
+            if (predicted_dead && dbp->mode == DEAD_BLOCK_BYPASS) {
+                if (cache_system->verbose) printf("  bypass 0x%x\n", address);
+                dead_block_predictor_record_bypass(dbp, line_addr, rw);
+                if (cache_system->way_predictor) {
+                    way_predictor_bypass(cache_system->way_predictor);
+                }
+                return 0;
+            }
+        }
+
         // See if there's an open index.
         int insert_index = -1;
         int set_start = set_idx * cache_system->associativity;
@@ -89,42 +187,122 @@ int cache_system_mem_access(struct cache_system *cache_system, uint32_t address,
             struct cache_line evicted = cache_system->cache_lines[set_start + evicted_index];
             if (evicted.status == MODIFIED) {
                 cache_system->stats.dirty_evictions++;
+                cache_system->last_access.writeback = true;
+                cache_system->last_access.writeback_addr =
+                    (evicted.tag * cache_system->num_sets + set_idx) * cache_system->line_size;
             }
 
-            printf("  evict %s cache line from set %d index %d\n",
-                   (evicted.status == MODIFIED ? "dirty" : "clean"), set_idx, evicted_index);
+            if (cache_system->verbose) {
+                printf("  evict %s cache line from set %d index %d\n",
+                       (evicted.status == MODIFIED ? "dirty" : "clean"), set_idx, evicted_index);
+            }
 
             // Use the evicted index as the insert index.
             insert_index = evicted_index;
         }
 
-        printf("  store cache line with tag 0x%x in set %d index %d\n", tag, set_idx, insert_index);
+        if (cache_system->verbose) {
+            printf("  store cache line with tag 0x%x in set %d index %d\n", tag, set_idx,
+                   insert_index);
+        }
 
         // Change the tag of the cache line, and set cl to this cache line.
         cl = &cache_system->cache_lines[set_start + insert_index];
         cl->tag = tag;
         cl->status = (rw == 'W') ? MODIFIED : EXCLUSIVE;
+        filled = true;
+        if (cache_system->partial_tags) {
+            partial_tags_fill(cache_system->partial_tags, set_start + insert_index, tag);
+        }
+        if (dbp) dead_block_predictor_fill(dbp, set_start + insert_index);
     } else { // cache hit
-        printf("  0x%x hit: set %d, tag 0x%x, offset %d\n", address, set_idx, tag, offset);
+        if (cache_system->verbose) {
+            uint32_t offset = address - cache_system_line_addr(cache_system, address) *
+                                            cache_system->line_size;
+            printf("  0x%x hit: set %d, tag 0x%x, offset %d\n", address, set_idx, tag, offset);
+        }
         cache_system->stats.hits++;
+        cache_system->last_access.hit = true;
         if (rw == 'W') cl->status = MODIFIED;
+        if (dbp) {
+            predicted_dead =
+                dead_block_predictor_hit(dbp, cl - cache_system->cache_lines, line_addr);
+        }
+    }
+
+    cache_system->last_access.line_idx = cl - cache_system->cache_lines;
+    if (cache_system->way_predictor) {
+        struct cache_line *set_lines =
+            &cache_system->cache_lines[set_idx * cache_system->associativity];
+        way_predictor_access(cache_system->way_predictor, set_idx, tag,
+                             cache_system->last_access.hit, cl - set_lines);
     }
 
-    // Let the replacement policy know that the cache line was accessed.
+    // Let the replacement policy know that the cache line was accessed. This
+    // passes the tag of the line, which is not the accessed one after a false
+    // hit on a partial tag.
     (*cache_system->replacement_policy->cache_access)(cache_system->replacement_policy,
-                                                      cache_system, set_idx, tag);
+                                                      cache_system, set_idx, cl->tag);
+
+    // Lines predicted dead are moved to the LRU position so that they are the
+    // next to go, if the policy supports it.
+    if (predicted_dead && dbp->mode == DEAD_BLOCK_LRU_INSERT &&
+        cache_system->replacement_policy->demote) {
+        (*cache_system->replacement_policy->demote)(cache_system->replacement_policy,
+                                                    cache_system, set_idx, cl->tag);
+        dbp->stats.lru_insertions++;
+    }
+
+    if (cache_system->eager_writeback) {
+        eager_writeback_access(cache_system->eager_writeback, cache_system, set_idx,
+                               cl - cache_system->cache_lines, rw, filled);
+    }
 
     // Everything was successful.
     return 0;
 }
 
+int cache_system_mem_access_run(struct cache_system *cache_system, uint32_t line_addr,
+                                uint32_t count, bool write)
+{
+    // Only the first access of the run can miss. Making it a write when any
+    // access in the run writes leaves the line in the same state as applying
+    // the accesses one by one, and re-touching the MRU line is a no-op for
+    // the built-in policies.
+    uint32_t address = line_addr * cache_system->line_size;
+    if (cache_system_mem_access(cache_system, address, write ? 'W' : 'R') != 0) {
+        return 1;
+    }
+    cache_system->stats.accesses += count - 1;
+    cache_system->stats.hits += count - 1;
+    if (cache_system->way_predictor) {
+        // The rest of the run hits the way that the first access trained.
+        struct way_predictor_stats *wps = &cache_system->way_predictor->stats;
+        wps->hits += count - 1;
+        wps->correct += count - 1;
+        wps->ways_read += count - 1;
+    }
+    return 0;
+}
+
 struct cache_line *cache_system_find_cache_line(struct cache_system *cache_system, uint32_t set_idx,
                                                 uint32_t tag)
 {
     // DONE
+    if (cache_system->partial_tags) {
+        return partial_tags_find(cache_system->partial_tags, cache_system, set_idx, tag);
+    }
     int set_start = set_idx * cache_system->associativity;
     struct cache_line *start = &cache_system->cache_lines[set_start];
 
+    // Check the predicted way before scanning the set.
+    if (cache_system->way_predictor) {
+        uint32_t way = *way_predictor_entry(cache_system->way_predictor, set_idx, tag);
+        if (start[way].tag == tag && start[way].status != INVALID) {
+            return &start[way];
+        }
+    }
+
     for (int i = 0; i < cache_system->associativity; i++) {
         if (start[i].tag == tag && start[i].status != INVALID) {
             return &start[i]; // Return the pointer if the tag matches and the status is not INVALID
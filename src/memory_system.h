@@ -13,8 +13,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "fastdiv.h"
+
 struct replacement_policy;
 #include "replacement_policies.h"
+#include "dead_block_predictor.h"
+#include "eager_writeback.h"
+#include "partial_tags.h"
+#include "way_predictor.h"
 
 // This struct contains statistics about the cache performance.
 struct cache_system_stats {
@@ -24,6 +30,15 @@ struct cache_system_stats {
     uint32_t dirty_evictions; // Total number of cache evictions requiring write-back
 };
 
+// The outcome of the most recent access, for callers that model what happens
+// below the cache.
+struct cache_access_result {
+    bool hit;                // Whether the access hit
+    bool writeback;          // Whether a dirty line was evicted
+    uint32_t writeback_addr; // The address of the first byte of the evicted dirty line
+    int32_t line_idx;        // The flat index of the accessed line, or -1 if bypassed
+};
+
 // This enum keeps track of the status of each cache line in a set.
 enum cache_status {
     INVALID,   // The cache line is invalid.
@@ -39,8 +54,24 @@ struct cache_line {
 // This struct contains the data related to a cache system.
 struct cache_system {
     struct cache_system_stats stats;
+    struct cache_access_result last_access;
     struct replacement_policy *replacement_policy;
 
+    // Optional dead-block predictor (NULL if disabled).
+    struct dead_block_predictor *dead_block_predictor;
+
+    // Optional eager write-back engine (NULL if disabled).
+    struct eager_writeback *eager_writeback;
+
+    // Optional partial-tag lookups (NULL if disabled).
+    struct partial_tags *partial_tags;
+
+    // Optional way predictor (NULL if disabled).
+    struct way_predictor *way_predictor;
+
+    // Whether to print a line describing every access.
+    bool verbose;
+
     // The cache state
     uint32_t line_size, num_sets, associativity;
     uint32_t index_bits, tag_bits, offset_bits;
@@ -48,15 +79,78 @@ struct cache_system {
 
     // Masks and shifts
     uint32_t offset_mask, set_index_mask;
+
+    // Whether the line size and the number of sets are powers of two. If
+    // they are not, addresses are split with multiply-shift division by the
+    // precomputed magic numbers instead of with the masks and shifts.
+    bool line_size_pow2, num_sets_pow2;
+    uint64_t line_size_magic, num_sets_magic;
 };
 
-// Create a new cache system.
+// Returns NULL if the geometry is valid, or a description of the problem.
+const char *cache_system_check_geometry(size_t cache_size, size_t cache_lines,
+                                        size_t associativity);
+
+// Parse CACHE_SIZE, CACHE_LINES and ASSOCIATIVITY from args[0..2] and check
+// the geometry. Prints the problem and returns false if they are invalid.
+bool cache_system_parse_geometry(char **args, size_t *cache_size, size_t *cache_lines,
+                                 size_t *associativity);
+
+// Create a new cache system. The line size and number of sets need not be
+// powers of two.
 struct cache_system *cache_system_new(uint32_t line_size, uint32_t sets, uint32_t associativity);
 void cache_system_cleanup(struct cache_system *cache_system);
+void cache_system_print_geometry(struct cache_system *cache_system);
 
 // Perform updates to access memory
 int cache_system_mem_access(struct cache_system *cache_system, uint32_t address, char rw);
 
+// Same as cache_system_mem_access, for callers that have already split the
+// address with cache_system_decode (or an equivalent).
+int cache_system_mem_access_decoded(struct cache_system *cache_system, uint32_t address,
+                                    uint32_t set_idx, uint32_t tag, char rw);
+
+// Apply `count` consecutive accesses to the line with the given line address
+// as one lookup plus bulk statistics updates. `write` is whether any of the
+// accesses is a write. This is exactly equivalent to applying the accesses
+// one by one, as long as neither the dead-block predictor nor the eager
+// write-back engine is enabled (they act on every access).
+int cache_system_mem_access_run(struct cache_system *cache_system, uint32_t line_addr,
+                                uint32_t count, bool write);
+
+// Returns the line address (the address divided by the line size).
+static inline uint32_t cache_system_line_addr(struct cache_system *cs, uint32_t address)
+{
+    if (cs->line_size_pow2) return address >> cs->offset_bits;
+    return fastdiv_u32(address, cs->line_size_magic);
+}
+
+// Returns the offset of the address within its line.
+static inline uint32_t cache_system_line_offset(struct cache_system *cs, uint32_t address)
+{
+    if (cs->line_size_pow2) return address & cs->offset_mask;
+    return address - cache_system_line_addr(cs, address) * cs->line_size;
+}
+
+// Split an address into its set index and tag.
+static inline void cache_system_decode(struct cache_system *cs, uint32_t address,
+                                       uint32_t *set_idx, uint32_t *tag)
+{
+    if (cs->line_size_pow2 && cs->num_sets_pow2) {
+        *set_idx = (address & cs->set_index_mask) >> cs->offset_bits;
+        *tag = (uint64_t)address >> (cs->offset_bits + cs->index_bits);
+        return;
+    }
+    uint32_t line_addr = cache_system_line_addr(cs, address);
+    if (cs->num_sets_pow2) {
+        *set_idx = line_addr & (cs->num_sets - 1);
+        *tag = (uint64_t)line_addr >> cs->index_bits;
+    } else {
+        *set_idx = fastmod_u32(line_addr, cs->num_sets_magic, cs->num_sets);
+        *tag = fastdiv_u32(line_addr, cs->num_sets_magic);
+    }
+}
+
 // Returns a pointer to the cache line within the given set that has the given
 // tag. If no such element exists, then return NULL.
 struct cache_line *cache_system_find_cache_line(struct cache_system *cache_system, uint32_t set_idx,
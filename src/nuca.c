@@ -0,0 +1,324 @@
+//
+// This file contains the implementations for the functions defined in
+// nuca.h.
+//
+
+#include "nuca.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <sodium.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory_system.h"
+#include "replacement_policies.h"
+
+static bool nuca_is_pow2(uint32_t n)
+{
+    return n && !(n & (n - 1));
+}
+
+struct nuca *nuca_new(const char *policy, uint32_t line_size, uint32_t sets,
+                      uint32_t associativity, uint32_t rows, uint32_t cols,
+                      enum nuca_hash hash, bool dynamic)
+{
+    // The product is checked in 64 bits, before it can wrap.
+    if ((uint64_t)rows * cols > sets) {
+        fprintf(stderr, "--nuca needs at most as many banks (%" PRIu64 ") as sets (%u)\n",
+                (uint64_t)rows * cols, sets);
+        return NULL;
+    }
+    uint32_t banks = rows * cols;
+    if (sets % banks != 0) {
+        fprintf(stderr, "--nuca needs a number of sets (%u) that is a multiple of the number "
+                        "of banks (%u)\n",
+                sets, banks);
+        return NULL;
+    }
+    uint32_t num_partitions = dynamic ? cols : banks;
+    if (hash == NUCA_HASH_XOR && !nuca_is_pow2(num_partitions)) {
+        fprintf(stderr, "--nuca xor needs a power-of-two number of %s\n",
+                dynamic ? "columns" : "banks");
+        return NULL;
+    }
+
+    struct nuca *nuca = calloc(1, sizeof(struct nuca));
+    nuca->rows = rows;
+    nuca->cols = cols;
+    nuca->banks = banks;
+    nuca->hash = hash;
+    nuca->dynamic = dynamic;
+    nuca->line_size = line_size;
+    nuca->bank_caches = malloc(sizeof(struct cache_system *) * banks);
+    nuca->bank_stats = calloc(banks, sizeof(struct nuca_bank_stats));
+    nuca->hops = malloc(sizeof(uint32_t) * banks);
+    for (uint32_t b = 0; b < banks; b++) {
+        struct cache_system *bank = cache_system_new(line_size, sets / banks, associativity);
+        bank->verbose = false;
+        bank->replacement_policy =
+            replacement_policy_new_by_name(policy, bank->num_sets, bank->associativity);
+        nuca->bank_caches[b] = bank;
+
+        uint32_t r = b / cols, c = b % cols, core_col = cols / 2;
+        nuca->hops[b] = 1 + r + (c > core_col ? c - core_col : core_col - c);
+    }
+    nuca->num_partitions = num_partitions;
+    nuca->partitions = calloc(num_partitions, sizeof(struct nuca_partition));
+    return nuca;
+}
+
+void nuca_cleanup(struct nuca *nuca)
+{
+    for (uint32_t b = 0; b < nuca->banks; b++) {
+        cache_system_cleanup(nuca->bank_caches[b]);
+        free(nuca->bank_caches[b]);
+    }
+    for (uint32_t p = 0; p < nuca->num_partitions; p++) {
+        free(nuca->partitions[p].accesses);
+    }
+    free(nuca->bank_caches);
+    free(nuca->bank_stats);
+    free(nuca->hops);
+    free(nuca->partitions);
+}
+
+void nuca_add(struct nuca *nuca, uint32_t line_addr, char rw)
+{
+    // Both hashes keep the low bits recoverable from the partition and the
+    // local address, so that no two lines of a partition share one.
+    uint32_t n = nuca->num_partitions, p, local;
+    if (nuca->hash == NUCA_HASH_MOD) {
+        p = line_addr % n;
+        local = line_addr / n;
+    } else if (n == 1) {
+        // There are no bank bits to fold.
+        p = 0;
+        local = line_addr;
+    } else {
+        uint32_t bits = __builtin_ctz(n);
+        p = 0;
+        for (uint64_t rest = line_addr; rest; rest >>= bits) {
+            p ^= rest & (n - 1);
+        }
+        local = (uint64_t)line_addr >> bits;
+    }
+
+    struct nuca_partition *part = &nuca->partitions[p];
+    if (part->count == part->capacity) {
+        part->capacity = part->capacity ? part->capacity * 2 : 1024;
+        part->accesses = realloc(part->accesses, sizeof(struct nuca_access) * part->capacity);
+    }
+    struct nuca_access access = {nuca->seq++, local, rw == 'W'};
+    part->accesses[part->count++] = access;
+}
+
+static void nuca_touch(struct nuca *nuca, uint32_t bank, uint32_t seq)
+{
+    struct nuca_bank_stats *s = &nuca->bank_stats[bank];
+    if (s->accesses && seq - s->last_seq < NUCA_BUSY_ACCESSES) s->conflicts++;
+    s->accesses++;
+    s->last_seq = seq;
+}
+
+static uint32_t nuca_latency(struct nuca *nuca, uint32_t bank)
+{
+    return NUCA_BANK_CYCLES + NUCA_HOP_CYCLES * nuca->hops[bank];
+}
+
+// Move the line that was just accessed in bank `from` to bank `to`, and the
+// line that it replaces there to the slot it left. `scratch` holds a set.
+static int nuca_migrate(struct nuca *nuca, uint32_t from, uint32_t to, uint32_t seq,
+                        uint32_t address, struct cache_line *scratch)
+{
+    struct cache_system *src = nuca->bank_caches[from], *dst = nuca->bank_caches[to];
+    struct cache_line *cl = &src->cache_lines[src->last_access.line_idx];
+    bool dirty = cl->status == MODIFIED;
+    cl->status = INVALID;
+
+    uint32_t set_idx, tag;
+    cache_system_decode(dst, address, &set_idx, &tag);
+    uint32_t set_start = set_idx * dst->associativity;
+    memcpy(scratch, &dst->cache_lines[set_start], sizeof(struct cache_line) * dst->associativity);
+    nuca_touch(nuca, to, seq);
+    if (cache_system_mem_access(dst, address, dirty ? 'W' : 'R') != 0) {
+        return 1;
+    }
+
+    struct cache_line victim = scratch[dst->last_access.line_idx - set_start];
+    if (victim.status == INVALID) {
+        return 0;
+    }
+    uint32_t victim_addr = (victim.tag * dst->num_sets + set_idx) * dst->line_size;
+    nuca_touch(nuca, from, seq);
+    return cache_system_mem_access(src, victim_addr, victim.status == MODIFIED ? 'W' : 'R');
+}
+
+static int nuca_run_partition(struct nuca *nuca, uint32_t p)
+{
+    struct nuca_partition *part = &nuca->partitions[p];
+    struct cache_line *scratch =
+        malloc(sizeof(struct cache_line) * nuca->bank_caches[0]->associativity);
+    int ret = 0;
+    for (size_t i = 0; i < part->count && ret == 0; i++) {
+        struct nuca_access *a = &part->accesses[i];
+        uint32_t address = a->local * nuca->line_size;
+        char rw = a->write ? 'W' : 'R';
+
+        if (!nuca->dynamic) {
+            struct cache_system *bank = nuca->bank_caches[p];
+            nuca_touch(nuca, p, a->seq);
+            ret = cache_system_mem_access(bank, address, rw);
+            part->hits += bank->last_access.hit;
+            part->misses += !bank->last_access.hit;
+            part->dirty_evictions += bank->last_access.writeback;
+            part->hops += nuca->hops[p];
+            part->cycles += nuca_latency(nuca, p);
+            continue;
+        }
+
+        // Search every bank of the column at once.
+        uint32_t set_idx, tag;
+        cache_system_decode(nuca->bank_caches[p], address, &set_idx, &tag);
+        int32_t found = -1;
+        for (uint32_t r = 0; r < nuca->rows; r++) {
+            uint32_t b = r * nuca->cols + p;
+            nuca_touch(nuca, b, a->seq);
+            if (found < 0 && cache_system_find_cache_line(nuca->bank_caches[b], set_idx, tag)) {
+                found = r;
+            }
+        }
+
+        if (found >= 0) {
+            uint32_t b = found * nuca->cols + p;
+            part->hits++;
+            part->hops += nuca->hops[b];
+            part->cycles += nuca_latency(nuca, b);
+            ret = cache_system_mem_access(nuca->bank_caches[b], address, rw);
+            if (ret == 0 && found > 0) {
+                ret = nuca_migrate(nuca, b, b - nuca->cols, a->seq, address, scratch);
+                part->migrations++;
+            }
+        } else {
+            // A miss is known once the farthest bank has answered, and the
+            // line is filled there.
+            uint32_t b = (nuca->rows - 1) * nuca->cols + p;
+            struct cache_system *tail = nuca->bank_caches[b];
+            part->misses++;
+            part->hops += nuca->hops[b];
+            part->cycles += nuca_latency(nuca, b);
+            nuca_touch(nuca, b, a->seq);
+            ret = cache_system_mem_access(tail, address, rw);
+            part->dirty_evictions += tail->last_access.writeback;
+        }
+    }
+    free(scratch);
+    return ret;
+}
+
+struct nuca_worker {
+    struct nuca *nuca;
+    pthread_mutex_t *lock;
+    uint32_t *next;
+    int ret;
+};
+
+static void *nuca_worker_run(void *arg)
+{
+    struct nuca_worker *w = arg;
+    for (;;) {
+        pthread_mutex_lock(w->lock);
+        uint32_t p = (*w->next)++;
+        pthread_mutex_unlock(w->lock);
+        if (p >= w->nuca->num_partitions) break;
+        w->ret |= nuca_run_partition(w->nuca, p);
+    }
+    return NULL;
+}
+
+int nuca_run(struct nuca *nuca)
+{
+    // The RAND policy draws from libsodium in every worker.
+    if (sodium_init() < 0) {
+        fprintf(stderr, "Failed to initialize libsodium\n");
+        return 1;
+    }
+
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > nuca->num_partitions) threads = nuca->num_partitions;
+    if (threads < 1) threads = 1;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    uint32_t next = 0;
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    struct nuca_worker *workers = malloc(sizeof(struct nuca_worker) * threads);
+    bool *started = malloc(sizeof(bool) * threads);
+    for (long t = 0; t < threads; t++) {
+        struct nuca_worker worker = {nuca, &lock, &next, 0};
+        workers[t] = worker;
+        started[t] = pthread_create(&tids[t], NULL, nuca_worker_run, &workers[t]) == 0;
+    }
+    // If a worker could not be started, this thread takes its place.
+    for (long t = 0; t < threads; t++) {
+        if (!started[t]) {
+            nuca_worker_run(&workers[t]);
+        }
+    }
+    int ret = 0;
+    for (long t = 0; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        }
+        ret |= workers[t].ret;
+    }
+    free(tids);
+    free(workers);
+    free(started);
+    return ret;
+}
+
+void nuca_print(struct nuca *nuca)
+{
+    struct nuca_partition total;
+    memset(&total, 0, sizeof(total));
+    for (uint32_t p = 0; p < nuca->num_partitions; p++) {
+        struct nuca_partition *part = &nuca->partitions[p];
+        total.hits += part->hits;
+        total.misses += part->misses;
+        total.dirty_evictions += part->dirty_evictions;
+        total.migrations += part->migrations;
+        total.hops += part->hops;
+        total.cycles += part->cycles;
+    }
+    uint64_t accesses = total.hits + total.misses;
+    printf("OUTPUT NUCA ACCESSES %" PRIu64 "\n", accesses);
+    printf("OUTPUT NUCA HITS %" PRIu64 "\n", total.hits);
+    printf("OUTPUT NUCA MISSES %" PRIu64 "\n", total.misses);
+    printf("OUTPUT NUCA DIRTY EVICTIONS %" PRIu64 "\n", total.dirty_evictions);
+    printf("OUTPUT NUCA HIT RATIO %.8f\n", accesses ? (double)total.hits / accesses : 0.0);
+    if (nuca->dynamic) {
+        printf("OUTPUT NUCA MIGRATIONS %" PRIu64 "\n", total.migrations);
+    }
+    printf("OUTPUT NUCA AVERAGE HOPS %.4f\n", accesses ? (double)total.hops / accesses : 0.0);
+    printf("OUTPUT NUCA AVERAGE LATENCY %.4f CYCLES\n",
+           accesses ? (double)total.cycles / accesses : 0.0);
+
+    for (uint32_t r = 0; r < nuca->rows; r++) {
+        printf("OUTPUT NUCA LATENCY ROW %u", r);
+        for (uint32_t c = 0; c < nuca->cols; c++) {
+            printf(" %u", nuca_latency(nuca, r * nuca->cols + c));
+        }
+        printf("\n");
+    }
+
+    // The load balance is the busiest bank's accesses over the mean.
+    uint64_t bank_accesses = 0, busiest = 0;
+    for (uint32_t b = 0; b < nuca->banks; b++) {
+        struct nuca_bank_stats *s = &nuca->bank_stats[b];
+        printf("OUTPUT NUCA BANK %u %u ACCESSES %" PRIu64 " CONFLICTS %" PRIu64 "\n",
+               b / nuca->cols, b % nuca->cols, s->accesses, s->conflicts);
+        bank_accesses += s->accesses;
+        if (s->accesses > busiest) busiest = s->accesses;
+    }
+    printf("OUTPUT NUCA LOAD BALANCE %.4f\n",
+           bank_accesses ? (double)busiest * nuca->banks / bank_accesses : 0.0);
+}
@@ -0,0 +1,88 @@
+//
+// This file defines the structs and function signatures for the NUCA model
+// of the simulated cache: the same cache split into ROWS x COLS banks laid
+// out as a mesh, with the core attached to the middle of the first row. The
+// latency of a bank is NUCA_BANK_CYCLES plus NUCA_HOP_CYCLES for every hop
+// between the core and the bank.
+//
+// In static NUCA, every line has one home bank, chosen by the bank hash of
+// its line address. In dynamic NUCA, the bank hash only chooses a column: a
+// line may be in any bank of its column, all of which are searched, a line
+// that misses is filled into the farthest bank, and a line that hits moves
+// one bank closer to the core, swapping places with the victim there.
+//
+// The accesses are recorded during the trace pass and split by the banks
+// (static) or the columns (dynamic) that they can touch. Since these never
+// share a line, they are simulated independently, in parallel, at the end.
+//
+
+#ifndef NUCA_H
+#define NUCA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NUCA_BANK_CYCLES 4
+#define NUCA_HOP_CYCLES 2
+// An access to a bank that was also accessed by one of the previous
+// NUCA_BUSY_ACCESSES accesses of the trace is counted as a conflict.
+#define NUCA_BUSY_ACCESSES 4
+
+enum nuca_hash {
+    NUCA_HASH_MOD, // The line address modulo the number of banks
+    NUCA_HASH_XOR, // The XOR of every group of bank bits of the line address
+};
+
+struct nuca_access {
+    uint32_t seq;   // The position of the access in the trace
+    uint32_t local; // The line address within the bank
+    bool write;
+};
+
+// The accesses of one bank (static) or column (dynamic), and their results.
+struct nuca_partition {
+    struct nuca_access *accesses;
+    size_t count, capacity;
+
+    uint64_t hits, misses, dirty_evictions, migrations;
+    uint64_t hops, cycles;
+};
+
+struct nuca_bank_stats {
+    uint64_t accesses;  // Lookups, fills and migrations
+    uint64_t conflicts; // Accesses while the bank was busy
+    uint32_t last_seq;
+};
+
+struct nuca {
+    uint32_t rows, cols, banks;
+    enum nuca_hash hash;
+    bool dynamic;
+    uint32_t line_size;
+    uint32_t seq;
+
+    struct cache_system **bank_caches; // Bank (r, c) is bank_caches[r * cols + c].
+    struct nuca_bank_stats *bank_stats;
+    uint32_t *hops;                    // The hops between the core and every bank
+
+    struct nuca_partition *partitions;
+    uint32_t num_partitions;
+};
+
+// Split a cache of the given geometry and policy into ROWS x COLS banks.
+// Prints the problem and returns NULL if the cache cannot be split.
+struct nuca *nuca_new(const char *policy, uint32_t line_size, uint32_t sets,
+                      uint32_t associativity, uint32_t rows, uint32_t cols,
+                      enum nuca_hash hash, bool dynamic);
+void nuca_cleanup(struct nuca *nuca);
+
+// Record an access to the given line.
+void nuca_add(struct nuca *nuca, uint32_t line_addr, char rw);
+
+// Simulate the recorded accesses, on one thread per CPU.
+int nuca_run(struct nuca *nuca);
+
+void nuca_print(struct nuca *nuca);
+
+#endif
@@ -0,0 +1,138 @@
+//
+// This file contains the implementations for the functions defined in
+// page_locality.h.
+//
+
+#include "page_locality.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PAGE_LOCALITY_INITIAL_SIZE 1024
+
+static void page_locality_table_init(struct page_locality_table *table)
+{
+    table->index = hash_map_new(PAGE_LOCALITY_INITIAL_SIZE);
+    table->capacity = PAGE_LOCALITY_INITIAL_SIZE;
+    table->entries = malloc(sizeof(struct page_locality_entry) * table->capacity);
+    table->count = 0;
+}
+
+static void page_locality_table_cleanup(struct page_locality_table *table)
+{
+    hash_map_cleanup(table->index);
+    free(table->index);
+    free(table->entries);
+}
+
+// Returns the entry for the page (or region) containing address, creating it
+// if needed. `inserted` is set to whether it was created.
+static struct page_locality_entry *
+page_locality_table_get(struct page_locality_table *table, uint64_t address, uint32_t bits,
+                        bool *inserted)
+{
+    uint64_t *idx = hash_map_upsert(table->index, address >> bits, inserted);
+    if (*inserted) {
+        if (table->count == table->capacity) {
+            table->capacity *= 2;
+            table->entries =
+                realloc(table->entries, sizeof(struct page_locality_entry) * table->capacity);
+        }
+        *idx = table->count++;
+        struct page_locality_entry entry = {address >> bits << bits, 0, 0, 0, 0, 0};
+        table->entries[*idx] = entry;
+    }
+    return &table->entries[*idx];
+}
+
+struct page_locality *page_locality_new(uint32_t top)
+{
+    struct page_locality *pl = malloc(sizeof(struct page_locality));
+    if (!pl) {
+        return NULL;
+    }
+    pl->top = top;
+    pl->accesses = 0;
+    pl->misses = 0;
+    page_locality_table_init(&pl->pages);
+    page_locality_table_init(&pl->regions);
+    pl->lines = hash_map_new(PAGE_LOCALITY_INITIAL_SIZE);
+    return pl;
+}
+
+void page_locality_cleanup(struct page_locality *pl)
+{
+    page_locality_table_cleanup(&pl->pages);
+    page_locality_table_cleanup(&pl->regions);
+    hash_map_cleanup(pl->lines);
+    free(pl->lines);
+}
+
+void page_locality_access(struct page_locality *pl, uint64_t address, uint64_t line_addr,
+                          char rw, bool hit)
+{
+    bool new_line, new_page, new_region;
+    hash_map_upsert(pl->lines, line_addr, &new_line);
+    struct page_locality_entry *page =
+        page_locality_table_get(&pl->pages, address, PAGE_LOCALITY_PAGE_BITS, &new_page);
+    struct page_locality_entry *region =
+        page_locality_table_get(&pl->regions, address, PAGE_LOCALITY_REGION_BITS, &new_region);
+
+    pl->accesses++;
+    pl->misses += !hit;
+    struct page_locality_entry *entries[] = {page, region};
+    for (int i = 0; i < 2; i++) {
+        entries[i]->accesses++;
+        entries[i]->writes += rw == 'W';
+        entries[i]->misses += !hit;
+        entries[i]->lines += new_line;
+    }
+    region->pages += new_page;
+}
+
+// Order by misses, then accesses, descending; ties by address.
+static int page_locality_entry_compare(const void *a, const void *b)
+{
+    const struct page_locality_entry *x = a, *y = b;
+    if (x->misses != y->misses) return x->misses < y->misses ? 1 : -1;
+    if (x->accesses != y->accesses) return x->accesses < y->accesses ? 1 : -1;
+    return (x->base > y->base) - (x->base < y->base);
+}
+
+static void page_locality_print_top(struct page_locality *pl, struct page_locality_table *table,
+                                    const char *name)
+{
+    qsort(table->entries, table->count, sizeof(struct page_locality_entry),
+          page_locality_entry_compare);
+    for (size_t i = 0; i < table->count && i < pl->top; i++) {
+        struct page_locality_entry *e = &table->entries[i];
+        printf("OUTPUT TOP %s 0x%08" PRIx64 " ACCESSES %u LINES %u WRITE RATIO %.4f MISSES %u "
+               "MISS SHARE %.4f\n",
+               name, e->base, e->accesses, e->lines, (double)e->writes / e->accesses, e->misses,
+               pl->misses ? (double)e->misses / pl->misses : 0.0);
+    }
+}
+
+void page_locality_print(struct page_locality *pl)
+{
+    uint32_t pages_per_region = 1 << (PAGE_LOCALITY_REGION_BITS - PAGE_LOCALITY_PAGE_BITS);
+    size_t dense = 0;
+    uint64_t dense_accesses = 0, dense_misses = 0;
+    for (size_t i = 0; i < pl->regions.count; i++) {
+        struct page_locality_entry *e = &pl->regions.entries[i];
+        if (e->pages >= PAGE_LOCALITY_DENSE_FRACTION * pages_per_region) {
+            dense++;
+            dense_accesses += e->accesses;
+            dense_misses += e->misses;
+        }
+    }
+
+    printf("OUTPUT 4K PAGES %zu\n", pl->pages.count);
+    printf("OUTPUT 2M REGIONS %zu\n", pl->regions.count);
+    printf("OUTPUT DENSE 2M REGIONS %zu (%.4f) ACCESS SHARE %.4f MISS SHARE %.4f\n", dense,
+           pl->regions.count ? (double)dense / pl->regions.count : 0.0,
+           pl->accesses ? (double)dense_accesses / pl->accesses : 0.0,
+           pl->misses ? (double)dense_misses / pl->misses : 0.0);
+    page_locality_print_top(pl, &pl->pages, "4K PAGE");
+    page_locality_print_top(pl, &pl->regions, "2M REGION");
+}
@@ -0,0 +1,58 @@
+//
+// This file defines the structs and function signatures for the page
+// locality analysis, which aggregates the accesses and misses of the trace per
+// 4 KiB page and per 2 MiB region, to show where huge pages would pay off.
+// It uses the full addresses of the trace, so that the pages of a 64-bit
+// trace do not alias modulo 4 GiB.
+//
+
+#ifndef PAGE_LOCALITY_H
+#define PAGE_LOCALITY_H
+
+#include "hash_map.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PAGE_LOCALITY_PAGE_BITS 12
+#define PAGE_LOCALITY_REGION_BITS 21
+
+// A 2 MiB region is dense enough for a huge page when at least this fraction
+// of its 4 KiB pages are touched.
+#define PAGE_LOCALITY_DENSE_FRACTION 0.5
+
+struct page_locality_entry {
+    uint64_t base;
+    uint32_t accesses;
+    uint32_t writes;
+    uint32_t misses;
+    uint32_t lines; // Distinct lines touched
+    uint32_t pages; // Distinct 4 KiB pages touched (only for regions)
+};
+
+// The entries of one granularity, indexed through a hash map from page (or
+// region) number to entry index.
+struct page_locality_table {
+    struct hash_map *index;
+    struct page_locality_entry *entries;
+    size_t count, capacity;
+};
+
+struct page_locality {
+    uint32_t top; // Number of top pages and regions to report.
+    uint32_t accesses, misses;
+
+    struct page_locality_table pages, regions;
+    struct hash_map *lines; // The set of lines seen so far.
+};
+
+struct page_locality *page_locality_new(uint32_t top);
+void page_locality_cleanup(struct page_locality *pl);
+
+// `line_addr` is the full address divided by the line size.
+void page_locality_access(struct page_locality *pl, uint64_t address, uint64_t line_addr,
+                          char rw, bool hit);
+
+void page_locality_print(struct page_locality *pl);
+
+#endif
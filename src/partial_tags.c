@@ -0,0 +1,74 @@
+//
+// This file contains the implementations for the functions defined in
+// partial_tags.h.
+//
+
+#include "partial_tags.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "memory_system.h"
+
+struct partial_tags *partial_tags_new(uint32_t sets, uint32_t associativity, uint32_t bits,
+                                      bool hardware)
+{
+    struct partial_tags *pt = calloc(1, sizeof(struct partial_tags));
+    pt->bits = bits;
+    pt->mask = (uint16_t)((1u << bits) - 1);
+    pt->hardware = hardware;
+    pt->partial = calloc((size_t)sets * associativity, sizeof(uint16_t));
+    pt->full_tags = hash_map_new((size_t)sets * associativity);
+    return pt;
+}
+
+void partial_tags_cleanup(struct partial_tags *pt)
+{
+    free(pt->partial);
+    hash_map_cleanup(pt->full_tags);
+    free(pt->full_tags);
+}
+
+struct cache_line *partial_tags_find(struct partial_tags *pt, struct cache_system *cache_system,
+                                     uint32_t set_idx, uint32_t tag)
+{
+    pt->stats.lookups++;
+    uint32_t set_start = set_idx * cache_system->associativity;
+    uint16_t *partial = &pt->partial[set_start];
+    struct cache_line *lines = &cache_system->cache_lines[set_start];
+    uint16_t key = tag & pt->mask;
+
+    for (uint32_t i = 0; i < cache_system->associativity; i++) {
+        if (partial[i] != key || lines[i].status == INVALID) continue;
+        // Only a partial match reads the full tag.
+        uint32_t full_tag = (uint32_t)*hash_map_get(pt->full_tags, set_start + i);
+        if (pt->hardware) {
+            // The first partial match is the hit, whatever its full tag.
+            if (full_tag != tag) pt->stats.false_hits++;
+            return &lines[i];
+        }
+        pt->stats.full_checks++;
+        if (full_tag == tag) return &lines[i];
+        pt->stats.aliases++;
+    }
+    return NULL;
+}
+
+void partial_tags_print(struct partial_tags *pt, struct cache_system *cache_system)
+{
+    uint64_t lines = (uint64_t)cache_system->num_sets * cache_system->associativity;
+    printf("OUTPUT PARTIAL TAG BITS %u\n", pt->bits);
+    printf("OUTPUT PARTIAL TAG LOOKUPS %" PRIu64 "\n", pt->stats.lookups);
+    if (pt->hardware) {
+        printf("OUTPUT PARTIAL TAG FALSE HITS %" PRIu64 "\n", pt->stats.false_hits);
+        printf("OUTPUT PARTIAL TAG FALSE HIT RATIO %.8f\n",
+               cache_system->stats.hits ? (double)pt->stats.false_hits / cache_system->stats.hits
+                                        : 0.0);
+    } else {
+        printf("OUTPUT PARTIAL TAG FULL CHECKS %" PRIu64 "\n", pt->stats.full_checks);
+        printf("OUTPUT PARTIAL TAG ALIASES %" PRIu64 "\n", pt->stats.aliases);
+    }
+    // The bytes of a hardware tag array with partial and with full tags,
+    // without the status bits that both need.
+    printf("OUTPUT PARTIAL TAG STORAGE %" PRIu64 " BYTES (FULL TAGS %" PRIu64 " BYTES)\n",
+           (lines * pt->bits + 7) / 8, (lines * cache_system->tag_bits + 7) / 8);
+}
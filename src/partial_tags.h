@@ -0,0 +1,66 @@
+//
+// This file defines the struct and function signatures for partial-tag
+// lookups. Every way keeps only the low `bits` bits of its tag in a compact
+// array that is scanned, and the full tags are kept in a hash map by line
+// index that is only read for the ways whose partial tag matches.
+//
+// In the exact mode the result of every lookup is the same as with full tags,
+// and the statistics tell how often the full tags had to be read. In the
+// hardware mode, a partial match is a hit, as in a cache that only stores
+// partial tags, and the hits on a line with a different full tag are counted
+// as false hits.
+//
+
+#ifndef PARTIAL_TAGS_H
+#define PARTIAL_TAGS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "hash_map.h"
+
+struct cache_system;
+struct cache_line;
+
+#define PARTIAL_TAGS_MAX_BITS 16
+
+// Statistics about the partial-tag lookups.
+struct partial_tags_stats {
+    uint64_t lookups;     // Lookups in the cache
+    uint64_t full_checks; // Full tags read, one per partial match
+    uint64_t aliases;     // Partial matches whose full tag differed
+    uint64_t false_hits;  // Hits on a line with a different full tag (hardware mode)
+};
+
+struct partial_tags {
+    struct partial_tags_stats stats;
+
+    uint32_t bits;
+    uint16_t mask;
+    bool hardware; // Whether a partial match is a hit.
+
+    uint16_t *partial;          // The partial tag of every cache line, in the same order.
+    struct hash_map *full_tags; // The full tag of every filled line, by line index.
+};
+
+// Create partial tags of `bits` bits (1 to PARTIAL_TAGS_MAX_BITS) for a cache
+// with the given geometry.
+struct partial_tags *partial_tags_new(uint32_t sets, uint32_t associativity, uint32_t bits,
+                                      bool hardware);
+void partial_tags_cleanup(struct partial_tags *pt);
+
+// Called when cache line `line_idx` is filled with `tag`.
+static inline void partial_tags_fill(struct partial_tags *pt, uint32_t line_idx, uint32_t tag)
+{
+    pt->partial[line_idx] = tag & pt->mask;
+    *hash_map_upsert(pt->full_tags, line_idx, NULL) = tag;
+}
+
+// Same as cache_system_find_cache_line, through the partial tags.
+struct cache_line *partial_tags_find(struct partial_tags *pt, struct cache_system *cache_system,
+                                     uint32_t set_idx, uint32_t tag);
+
+// Print the statistics, and the tag storage compared to full tags.
+void partial_tags_print(struct partial_tags *pt, struct cache_system *cache_system);
+
+#endif
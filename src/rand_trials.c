@@ -0,0 +1,152 @@
+//
+// This file contains the implementations for the functions defined in
+// rand_trials.h.
+//
+// The inner loops run over the trials with no dependencies between them, so
+// the compiler turns them into SIMD compares and selects across 8 or 16
+// trials at a time.
+//
+
+#include "rand_trials.h"
+#include <math.h>
+#include <sodium.h>
+
+struct rand_trials *rand_trials_new(uint32_t sets, uint32_t associativity, uint32_t trials,
+                                    bool seeded, uint64_t seed)
+{
+    struct rand_trials *rt = malloc(sizeof(struct rand_trials));
+    if (!rt) {
+        return NULL;
+    }
+    rt->num_sets = sets;
+    rt->associativity = associativity;
+    rt->trials = trials;
+
+    rt->tags = calloc((size_t)sets * associativity * trials, sizeof(uint32_t));
+    rt->dirty = calloc((size_t)sets * associativity * trials, sizeof(uint8_t));
+    rt->fill = calloc((size_t)sets * trials, sizeof(uint32_t));
+    rt->rng = malloc(sizeof(uint64_t) * trials);
+    rt->draws = malloc(sizeof(uint32_t) * trials);
+    rt->hit_way = malloc(sizeof(int32_t) * trials);
+    rt->stats = calloc(trials, sizeof(struct cache_system_stats));
+
+    // xorshift64* must not start from zero.
+    randombytes_buf(rt->rng, sizeof(uint64_t) * trials);
+    for (uint32_t k = 0; k < trials; k++) {
+        rt->rng[k] |= 1;
+    }
+
+    rt->streams = NULL;
+    if (seeded) {
+        rt->streams = malloc(sizeof(struct rng_streams *) * trials);
+        for (uint32_t k = 0; k < trials; k++) {
+            rt->streams[k] = rng_streams_new(seed, k, sets);
+        }
+    }
+    return rt;
+}
+
+void rand_trials_cleanup(struct rand_trials *rt)
+{
+    free(rt->tags);
+    free(rt->dirty);
+    free(rt->fill);
+    free(rt->rng);
+    free(rt->draws);
+    free(rt->hit_way);
+    free(rt->stats);
+    if (rt->streams) {
+        for (uint32_t k = 0; k < rt->trials; k++) {
+            rng_streams_cleanup(rt->streams[k]);
+            free(rt->streams[k]);
+        }
+        free(rt->streams);
+    }
+}
+
+// Draw one number in [0, associativity) for every trial. The bound is applied
+// with a multiply-shift, whose bias of at most associativity / 2^32 is
+// negligible (and zero for power-of-two associativities).
+static void rand_trials_draw(struct rand_trials *rt)
+{
+    uint64_t *rng = rt->rng;
+    uint32_t *draws = rt->draws;
+    uint64_t assoc = rt->associativity;
+    for (uint32_t k = 0; k < rt->trials; k++) {
+        uint64_t x = rng[k];
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        rng[k] = x;
+        uint64_t r = (x * 0x2545f4914f6cdd1dULL) >> 32;
+        draws[k] = (uint32_t)((r * assoc) >> 32);
+    }
+}
+
+void rand_trials_access(struct rand_trials *rt, uint32_t set_idx, uint32_t tag, char rw)
+{
+    uint32_t trials = rt->trials;
+    uint32_t assoc = rt->associativity;
+    size_t set_start = (size_t)set_idx * assoc * trials;
+    uint32_t *fill = &rt->fill[(size_t)set_idx * trials];
+    int32_t *hit_way = rt->hit_way;
+
+    // Compare the tag against the same way of every trial at once.
+    for (uint32_t k = 0; k < trials; k++) {
+        hit_way[k] = -1;
+    }
+    for (uint32_t w = 0; w < assoc; w++) {
+        const uint32_t *tags = &rt->tags[set_start + (size_t)w * trials];
+        for (uint32_t k = 0; k < trials; k++) {
+            hit_way[k] = (tags[k] == tag && w < fill[k]) ? (int32_t)w : hit_way[k];
+        }
+    }
+
+    // Only draw random numbers if some trial has to evict.
+    bool evict = false;
+    for (uint32_t k = 0; k < trials; k++) {
+        evict |= hit_way[k] < 0 && fill[k] == assoc;
+    }
+    if (evict && !rt->streams) {
+        rand_trials_draw(rt);
+    }
+
+    for (uint32_t k = 0; k < trials; k++) {
+        struct cache_system_stats *stats = &rt->stats[k];
+        stats->accesses++;
+        if (hit_way[k] >= 0) {
+            stats->hits++;
+            if (rw == 'W') rt->dirty[set_start + (size_t)hit_way[k] * trials + k] = 1;
+            continue;
+        }
+
+        stats->misses++;
+        uint32_t way;
+        if (fill[k] < assoc) {
+            way = fill[k]++;
+        } else if (rt->streams) {
+            way = rng_streams_uniform(rt->streams[k], set_idx, assoc);
+        } else {
+            way = rt->draws[k];
+        }
+        size_t i = set_start + (size_t)way * trials + k;
+        if (rt->dirty[i]) stats->dirty_evictions++;
+        rt->tags[i] = tag;
+        rt->dirty[i] = rw == 'W';
+    }
+}
+
+void rand_trials_print(struct rand_trials *rt)
+{
+    double sum = 0, sum_sq = 0;
+    for (uint32_t k = 0; k < rt->trials; k++) {
+        double hit_ratio = (double)rt->stats[k].hits / rt->stats[k].accesses;
+        printf("OUTPUT TRIAL %u HIT RATIO %.8f\n", k, hit_ratio);
+        sum += hit_ratio;
+        sum_sq += hit_ratio * hit_ratio;
+    }
+    double mean = sum / rt->trials;
+    double variance = rt->trials > 1 ? (sum_sq - sum * mean) / (rt->trials - 1) : 0;
+    printf("OUTPUT TRIALS HIT RATIO MEAN %.8f\n", mean);
+    printf("OUTPUT TRIALS HIT RATIO STDDEV %.8f\n", sqrt(variance > 0 ? variance : 0));
+}
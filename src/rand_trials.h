@@ -0,0 +1,59 @@
+//
+// This file defines the struct and function signatures for running many
+// trials of the RAND replacement policy in lockstep. All of the trials see
+// the same accesses on the same geometry, and only their random victim
+// choices differ, so their tag arrays are stored side by side and every
+// access is decoded once and compared against all trials at once.
+//
+
+#ifndef RAND_TRIALS_H
+#define RAND_TRIALS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "memory_system.h"
+#include "rng_stream.h"
+
+#define RAND_TRIALS_MAX 64
+
+struct rand_trials {
+    uint32_t num_sets, associativity, trials;
+
+    // tags[(set_idx * associativity + way) * trials + trial], so the same
+    // way of the same set is contiguous across all trials.
+    uint32_t *tags;
+    uint8_t *dirty;
+
+    // fill[set_idx * trials + trial] is the number of valid ways in the set.
+    // Lines are never invalidated, so the valid ways are always the first
+    // `fill` ways.
+    uint32_t *fill;
+
+    // One xorshift64* generator per trial, and scratch space for one access.
+    // If the trials are seeded, streams[trial] holds the reproducible per-set
+    // streams of each trial instead, and victims are drawn from them.
+    struct rng_streams **streams;
+    uint64_t *rng;
+    uint32_t *draws;
+    int32_t *hit_way;
+
+    struct cache_system_stats *stats;
+};
+
+// Create `trials` (at most RAND_TRIALS_MAX) RAND caches with the given
+// geometry. The generators are seeded from libsodium, unless `seeded` is
+// set, in which case trial k draws exactly the victims that RAND:SEED would
+// for trial k.
+struct rand_trials *rand_trials_new(uint32_t sets, uint32_t associativity, uint32_t trials,
+                                    bool seeded, uint64_t seed);
+void rand_trials_cleanup(struct rand_trials *rt);
+
+// Apply one decoded access to every trial.
+void rand_trials_access(struct rand_trials *rt, uint32_t set_idx, uint32_t tag, char rw);
+
+// Print the hit ratio of every trial and their mean and standard deviation.
+void rand_trials_print(struct rand_trials *rt);
+
+#endif
@@ -0,0 +1,212 @@
+//
+// This file contains the implementations for the functions defined in
+// reference.h.
+//
+
+#include "reference.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "replacement_policies.h"
+
+struct reference_cache *reference_cache_new(const char *policy, uint32_t line_size,
+                                            uint32_t sets, uint32_t associativity)
+{
+    uint32_t window, write_cost;
+    int end = 0;
+    if (!strcmp(policy, "LRU")) {
+        window = 0;
+    } else if (!strcmp(policy, "LRU_PREFER_CLEAN")) {
+        window = associativity;
+    } else if (sscanf(policy, "DIRTY_AWARE:%u:%u%n", &window, &write_cost, &end) == 2 &&
+               policy[end] == '\0' && window > 0) {
+        // See the DIRTY_AWARE comment in replacement_policies.c.
+        if (write_cost < window) window = write_cost;
+    } else {
+        return NULL;
+    }
+
+    struct reference_cache *ref = malloc(sizeof(struct reference_cache));
+    if (!ref) {
+        return NULL;
+    }
+    ref->line_size = line_size;
+    ref->num_sets = sets;
+    ref->associativity = associativity;
+    ref->clean_window = window < associativity ? window : associativity;
+    ref->lines = calloc((size_t)sets * associativity, sizeof(struct reference_line));
+    ref->counts = calloc(sets, sizeof(uint32_t));
+    ref->ref_addrs = malloc(sizeof(uint32_t) * associativity);
+    ref->fast_addrs = malloc(sizeof(uint32_t) * associativity);
+    ref->ways = malloc(sizeof(uint32_t) * associativity);
+    ref->ref_dirty = malloc(sizeof(bool) * associativity);
+    ref->fast_dirty = malloc(sizeof(bool) * associativity);
+    struct cache_system_stats stats = {0, 0, 0, 0};
+    ref->stats = stats;
+    return ref;
+}
+
+void reference_cache_cleanup(struct reference_cache *ref)
+{
+    free(ref->lines);
+    free(ref->counts);
+    free(ref->ref_addrs);
+    free(ref->fast_addrs);
+    free(ref->ways);
+    free(ref->ref_dirty);
+    free(ref->fast_dirty);
+}
+
+// Move line i of the set to the most recently used end.
+static void reference_cache_touch(struct reference_line *set, uint32_t count, uint32_t i)
+{
+    struct reference_line line = set[i];
+    memmove(&set[i], &set[i + 1], (count - i - 1) * sizeof(struct reference_line));
+    set[count - 1] = line;
+}
+
+void reference_cache_access(struct reference_cache *ref, uint32_t address, char rw,
+                            struct cache_access_result *result)
+{
+    uint32_t line_addr = address / ref->line_size;
+    uint32_t set_idx = line_addr % ref->num_sets;
+    struct reference_line *set = &ref->lines[(size_t)set_idx * ref->associativity];
+    uint32_t *count = &ref->counts[set_idx];
+    struct cache_access_result r = {false, false, 0, -1};
+
+    ref->stats.accesses++;
+    for (uint32_t i = 0; i < *count; i++) {
+        if (set[i].line_addr == line_addr) {
+            ref->stats.hits++;
+            set[i].dirty |= rw == 'W';
+            reference_cache_touch(set, *count, i);
+            r.hit = true;
+            *result = r;
+            return;
+        }
+    }
+
+    ref->stats.misses++;
+    if (*count == ref->associativity) {
+        uint32_t victim = 0;
+        for (uint32_t i = 0; i < ref->clean_window; i++) {
+            if (!set[i].dirty) {
+                victim = i;
+                break;
+            }
+        }
+        if (set[victim].dirty) {
+            ref->stats.dirty_evictions++;
+            r.writeback = true;
+            r.writeback_addr = set[victim].line_addr * ref->line_size;
+        }
+        reference_cache_touch(set, *count, victim);
+    } else {
+        (*count)++;
+    }
+    struct reference_line line = {line_addr, rw == 'W'};
+    set[*count - 1] = line;
+    *result = r;
+}
+
+// Print a set as "line_addr[*]" from least to most recently used, where *
+// marks dirty lines.
+static int reference_print_lines(char *out, size_t size, const uint32_t *line_addrs,
+                                 const bool *dirty, uint32_t count)
+{
+    int n = 0;
+    for (uint32_t i = 0; i < count && n < (int)size; i++) {
+        n += snprintf(out + n, size - n, " 0x%x%s", line_addrs[i], dirty[i] ? "*" : "");
+    }
+    return n;
+}
+
+bool reference_cache_compare_set(struct reference_cache *ref, struct cache_system *cache_system,
+                                 uint32_t set_idx, char *diff, size_t size)
+{
+    uint32_t assoc = ref->associativity;
+    uint32_t *ref_addrs = ref->ref_addrs, *fast_addrs = ref->fast_addrs, *ways = ref->ways;
+    bool *ref_dirty = ref->ref_dirty, *fast_dirty = ref->fast_dirty;
+
+    uint32_t ref_count = ref->counts[set_idx];
+    for (uint32_t i = 0; i < ref_count; i++) {
+        struct reference_line *line = &ref->lines[(size_t)set_idx * assoc + i];
+        ref_addrs[i] = line->line_addr;
+        ref_dirty[i] = line->dirty;
+    }
+
+    // The valid lines of cache_system in the policy's recency order, or in
+    // way order, in which case the reference is compared as a set.
+    struct replacement_policy *policy = cache_system->replacement_policy;
+    bool ordered = policy->recency_order != NULL;
+    if (ordered) {
+        (*policy->recency_order)(policy, cache_system, set_idx, ways);
+    } else {
+        for (uint32_t i = 0; i < assoc; i++) ways[i] = i;
+    }
+    uint32_t fast_count = 0;
+    for (uint32_t i = 0; i < assoc; i++) {
+        struct cache_line *cl = &cache_system->cache_lines[set_idx * assoc + ways[i]];
+        if (cl->status == INVALID) continue;
+        fast_addrs[fast_count] = cl->tag * cache_system->num_sets + set_idx;
+        fast_dirty[fast_count++] = cl->status == MODIFIED;
+    }
+
+    bool equal = ref_count == fast_count;
+    for (uint32_t i = 0; equal && i < ref_count; i++) {
+        uint32_t j = i;
+        if (!ordered) {
+            for (j = 0; j < fast_count && fast_addrs[j] != ref_addrs[i]; j++);
+        }
+        equal = j < fast_count && fast_addrs[j] == ref_addrs[i] && fast_dirty[j] == ref_dirty[i];
+    }
+    if (!equal) {
+        int n = snprintf(diff, size, "set %u (lines, LRU first, * = dirty)\n  reference:", set_idx);
+        n += reference_print_lines(diff + n, n < (int)size ? size - n : 0, ref_addrs, ref_dirty,
+                                   ref_count);
+        if (n < (int)size) n += snprintf(diff + n, size - n, "\n  fast:     ");
+        if (n < (int)size) {
+            reference_print_lines(diff + n, size - n, fast_addrs, fast_dirty, fast_count);
+        }
+    }
+    return equal;
+}
+
+bool reference_cache_check_access(struct reference_cache *ref, struct cache_system *cache_system,
+                                  uint32_t address, char rw, char *diff, size_t size)
+{
+    struct cache_access_result r;
+    reference_cache_access(ref, address, rw, &r);
+    struct cache_access_result *f = &cache_system->last_access;
+    if (r.hit != f->hit || r.writeback != f->writeback ||
+        (r.writeback && r.writeback_addr != f->writeback_addr)) {
+        snprintf(diff, size,
+                 "access outcome (hit, write-back, write-back address)\n"
+                 "  reference: %d %d 0x%x\n  fast:      %d %d 0x%x",
+                 r.hit, r.writeback, r.writeback_addr, f->hit, f->writeback, f->writeback_addr);
+        return false;
+    }
+    uint32_t set_idx = address / ref->line_size % ref->num_sets;
+    return reference_cache_compare_set(ref, cache_system, set_idx, diff, size);
+}
+
+bool reference_cache_compare(struct reference_cache *ref, struct cache_system *cache_system,
+                             char *diff, size_t size)
+{
+    struct cache_system_stats *a = &ref->stats, *b = &cache_system->stats;
+    if (a->accesses != b->accesses || a->hits != b->hits || a->misses != b->misses ||
+        a->dirty_evictions != b->dirty_evictions) {
+        snprintf(diff, size,
+                 "statistics (accesses, hits, misses, dirty evictions)\n"
+                 "  reference: %u %u %u %u\n  fast:      %u %u %u %u",
+                 a->accesses, a->hits, a->misses, a->dirty_evictions, b->accesses, b->hits,
+                 b->misses, b->dirty_evictions);
+        return false;
+    }
+    for (uint32_t s = 0; s < ref->num_sets; s++) {
+        if (!reference_cache_compare_set(ref, cache_system, s, diff, size)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+//
+// This file defines the reference cache engine. It models the same caches as
+// cache_system with the plainest possible logic (division for decoding, each
+// set kept as a list in recency order, a linear scan for every decision), so
+// that the optimized paths of cache_system can be checked against it access
+// by access.
+//
+// Only the deterministic policies are modeled: LRU, LRU_PREFER_CLEAN and
+// DIRTY_AWARE:WINDOW:WRITE_COST.
+//
+
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "memory_system.h"
+
+struct reference_line {
+    uint32_t line_addr; // address / line size
+    bool dirty;
+};
+
+struct reference_cache {
+    uint32_t line_size, num_sets, associativity;
+
+    // Evict the least recently used clean line among the `clean_window`
+    // least recently used lines, or else the least recently used line. LRU is
+    // a window of 0, LRU_PREFER_CLEAN a window of the associativity.
+    uint32_t clean_window;
+
+    // The valid lines of each set, from least to most recently used.
+    struct reference_line *lines;
+    uint32_t *counts;
+
+    // Scratch space for one set, for reference_cache_compare_set.
+    uint32_t *ref_addrs, *fast_addrs, *ways;
+    bool *ref_dirty, *fast_dirty;
+
+    struct cache_system_stats stats;
+};
+
+// Returns NULL if the policy is not one the reference engine models.
+struct reference_cache *reference_cache_new(const char *policy, uint32_t line_size,
+                                            uint32_t sets, uint32_t associativity);
+void reference_cache_cleanup(struct reference_cache *ref);
+
+void reference_cache_access(struct reference_cache *ref, uint32_t address, char rw,
+                            struct cache_access_result *result);
+
+// Compare a set of the reference with the same set of cache_system: the same
+// lines, with the same dirty bits, in the same recency order (when the policy
+// of cache_system reports one). Returns true if they match; otherwise writes
+// both sets to `diff`.
+bool reference_cache_compare_set(struct reference_cache *ref, struct cache_system *cache_system,
+                                 uint32_t set_idx, char *diff, size_t size);
+
+// Apply an access that cache_system has just performed to the reference too,
+// and compare the outcome and the accessed set. Returns true if they match;
+// otherwise describes the difference in `diff`.
+bool reference_cache_check_access(struct reference_cache *ref, struct cache_system *cache_system,
+                                  uint32_t address, char rw, char *diff, size_t size);
+
+// Compare the statistics and every set.
+bool reference_cache_compare(struct reference_cache *ref, struct cache_system *cache_system,
+                             char *diff, size_t size);
+
+#endif
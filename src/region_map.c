@@ -0,0 +1,183 @@
+//
+// This file contains the implementations for the functions defined in
+// region_map.h.
+//
+
+#include "region_map.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static struct region_map *region_map_alloc(uint32_t cache_lines)
+{
+    struct region_map *map = malloc(sizeof(struct region_map));
+    if (!map) {
+        return NULL;
+    }
+    map->count = 0;
+    map->capacity = 16;
+    map->regions = malloc(sizeof(struct region) * map->capacity);
+    map->cluster_bits = 0;
+    map->clusters = NULL;
+    map->last = 0;
+    map->line_regions = calloc(cache_lines, sizeof(uint32_t));
+    return map;
+}
+
+static uint32_t region_map_add(struct region_map *map, const char *name, uint64_t base,
+                               uint64_t limit)
+{
+    if (map->count == map->capacity) {
+        map->capacity *= 2;
+        map->regions = realloc(map->regions, sizeof(struct region) * map->capacity);
+    }
+    struct region region = {"", base, limit, 0, 0, 0, 0};
+    snprintf(region.name, REGION_NAME_LENGTH, "%s", name);
+    map->regions[map->count] = region;
+    return map->count++;
+}
+
+static int region_compare(const void *a, const void *b)
+{
+    const struct region *x = a, *y = b;
+    return (x->base > y->base) - (x->base < y->base);
+}
+
+struct region_map *region_map_read(const char *path, uint32_t cache_lines)
+{
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return NULL;
+    }
+    struct region_map *map = region_map_alloc(cache_lines);
+
+    char line[256], name[REGION_NAME_LENGTH];
+    uint64_t base, limit;
+    for (int lineno = 1; fgets(line, sizeof(line), in); lineno++) {
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        if (sscanf(p, "%31s %" SCNx64 " %" SCNx64, name, &base, &limit) != 3 || base >= limit) {
+            fprintf(stderr, "%s:%d: expected NAME BASE LIMIT with BASE < LIMIT\n", path, lineno);
+            fclose(in);
+            region_map_cleanup(map);
+            free(map);
+            return NULL;
+        }
+        region_map_add(map, name, base, limit);
+    }
+    fclose(in);
+
+    qsort(map->regions, map->count, sizeof(struct region), region_compare);
+    for (size_t i = 1; i < map->count; i++) {
+        if (map->regions[i].base < map->regions[i - 1].limit) {
+            fprintf(stderr, "%s: regions %s and %s overlap\n", path, map->regions[i - 1].name,
+                    map->regions[i].name);
+            region_map_cleanup(map);
+            free(map);
+            return NULL;
+        }
+    }
+    region_map_add(map, "OTHER", 0, 0);
+    return map;
+}
+
+struct region_map *region_map_new_clustered(uint32_t bits, uint32_t cache_lines)
+{
+    struct region_map *map = region_map_alloc(cache_lines);
+    if (!map) {
+        return NULL;
+    }
+    map->cluster_bits = bits;
+    map->clusters = hash_map_new(16);
+    return map;
+}
+
+void region_map_cleanup(struct region_map *map)
+{
+    free(map->regions);
+    free(map->line_regions);
+    if (map->clusters) {
+        hash_map_cleanup(map->clusters);
+        free(map->clusters);
+    }
+}
+
+static uint32_t region_map_lookup(struct region_map *map, uint64_t address)
+{
+    struct region *last = &map->regions[map->last];
+    if (map->count > 0 && last->base <= address && address < last->limit) {
+        return map->last;
+    }
+
+    if (map->clusters) {
+        uint64_t cluster = address >> map->cluster_bits;
+        bool inserted;
+        uint64_t *idx = hash_map_upsert(map->clusters, cluster, &inserted);
+        if (inserted) {
+            uint64_t base = cluster << map->cluster_bits;
+            char name[REGION_NAME_LENGTH];
+            snprintf(name, sizeof(name), "0x%" PRIx64, base);
+            *idx = region_map_add(map, name, base, base + ((uint64_t)1 << map->cluster_bits));
+        }
+        return map->last = *idx;
+    }
+
+    // Binary search for the last range starting at or before the address.
+    size_t ranges = map->count - 1, lo = 0, hi = ranges;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (map->regions[mid].base <= address) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo > 0 && address < map->regions[lo - 1].limit) {
+        return map->last = lo - 1;
+    }
+    return map->last = ranges; // OTHER
+}
+
+void region_map_access(struct region_map *map, uint64_t address, bool hit, bool writeback,
+                       int32_t line_idx)
+{
+    uint32_t idx = region_map_lookup(map, address);
+    struct region *region = &map->regions[idx];
+    region->accesses++;
+    if (hit) {
+        region->hits++;
+        return;
+    }
+    region->misses++;
+
+    // The filled line held the evicted one, so its old owner is charged for
+    // the write-back before the line changes hands.
+    if (line_idx < 0) {
+        return;
+    }
+    if (writeback) {
+        map->regions[map->line_regions[line_idx]].dirty_evictions++;
+    }
+    map->line_regions[line_idx] = idx;
+}
+
+void region_map_print(struct region_map *map)
+{
+    // Clusters are created in order of first access; report them by address.
+    if (map->clusters) {
+        qsort(map->regions, map->count, sizeof(struct region), region_compare);
+    }
+    for (size_t i = 0; i < map->count; i++) {
+        struct region *r = &map->regions[i];
+        if (r->accesses == 0 && r->dirty_evictions == 0) {
+            continue;
+        }
+        printf("OUTPUT REGION %s ACCESSES %" PRIu64 " HITS %" PRIu64 " MISSES %" PRIu64
+               " DIRTY EVICTIONS %" PRIu64 " HIT RATIO %.8f\n",
+               r->name, r->accesses, r->hits, r->misses, r->dirty_evictions,
+               r->accesses ? (double)r->hits / r->accesses : 0.0);
+    }
+}
@@ -0,0 +1,69 @@
+//
+// This file defines the structs and function signatures for region maps,
+// which split the cache statistics by address region (e.g. stack, heap and
+// shared libraries). The regions are either read from a file of base/limit
+// ranges, or formed automatically from the high bits of the addresses.
+//
+
+#ifndef REGION_MAP_H
+#define REGION_MAP_H
+
+#include "hash_map.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define REGION_NAME_LENGTH 32
+
+struct region {
+    char name[REGION_NAME_LENGTH];
+    uint64_t base, limit; // The region is [base, limit).
+
+    uint64_t accesses;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t dirty_evictions;
+};
+
+struct region_map {
+    // The regions, sorted by base. When reading from a file, the last one
+    // is the catch-all region for addresses outside of all ranges.
+    struct region *regions;
+    size_t count, capacity;
+
+    // For automatic clustering, the number of low bits dropped from an
+    // address to get its cluster, and the map from cluster to region index.
+    // Zero and NULL for maps read from a file.
+    uint32_t cluster_bits;
+    struct hash_map *clusters;
+
+    // The region of the last lookup; consecutive accesses mostly stay in the
+    // same region.
+    uint32_t last;
+
+    // The region of the data held by each cache line, so that dirty
+    // evictions are charged to the region that dirtied the line.
+    uint32_t *line_regions;
+};
+
+// Read a region map from a file with one region per line:
+//     NAME BASE LIMIT
+// where BASE and LIMIT are hexadecimal and LIMIT is exclusive. Lines starting
+// with '#' are ignored. Returns NULL (after printing why) if the file cannot
+// be read or the ranges overlap.
+struct region_map *region_map_read(const char *path, uint32_t cache_lines);
+
+// Create a region map with one region per distinct value of address >> bits.
+// bits must be between 1 and 63.
+struct region_map *region_map_new_clustered(uint32_t bits, uint32_t cache_lines);
+
+void region_map_cleanup(struct region_map *map);
+
+// Record an access, given its full address and the outcome of the access in
+// the cache (`line_idx` is -1 when the line was not allocated).
+void region_map_access(struct region_map *map, uint64_t address, bool hit, bool writeback,
+                       int32_t line_idx);
+
+void region_map_print(struct region_map *map);
+
+#endif
@@ -14,8 +14,12 @@
 // Modified by Shenyao Jin, shenyaojin@mines.edu
 
 #include "replacement_policies.h"
+#include <inttypes.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "memory_system.h"
+#include "rng_stream.h"
 #include <sodium.h>
 
 // LRU Replacement Policy
@@ -99,6 +103,59 @@ static void lru_cache_access(struct replacement_policy *replacement_policy,
     metadata->order[set_idx][0] = accessed_line_idx;
 }
 
+/**
+ * Move the accessed line to the LRU position (the tail of the order array).
+ * Shared by LRU and LRU_PREFER_CLEAN.
+ */
+static void lru_demote(struct replacement_policy *replacement_policy,
+                       struct cache_system *cache_system,
+                       uint32_t set_idx,
+                       uint32_t tag)
+{
+    struct lru_metadata *metadata = (struct lru_metadata *)replacement_policy->data;
+    uint32_t assoc = metadata->associativity;
+    uint32_t *order = metadata->order[set_idx];
+
+    // Find the line by scanning the set, like the access hooks do, so that
+    // the demotion is not counted as a lookup by the partial tags.
+    struct cache_line *lines = &cache_system->cache_lines[set_idx * assoc];
+    uint32_t line_idx = 0;
+    while (line_idx < assoc && (lines[line_idx].tag != tag || lines[line_idx].status == INVALID)) {
+        line_idx++;
+    }
+    if (line_idx == assoc) {
+        return; // Defensive check
+    }
+
+    // Shift [p+1...assoc-1] one position toward the head, then place the line at the tail.
+    uint32_t p = 0;
+    while (p < assoc && order[p] != line_idx) p++;
+    if (p == assoc) {
+        return; // Defensive check
+    }
+    for (uint32_t i = p; i + 1 < assoc; i++) {
+        order[i] = order[i + 1];
+    }
+    order[assoc - 1] = line_idx;
+}
+
+/**
+ * Report the order array of the set reversed, i.e. from LRU to MRU.
+ * Shared by LRU and LRU_PREFER_CLEAN.
+ */
+static void lru_recency_order(struct replacement_policy *replacement_policy,
+                              struct cache_system *cache_system,
+                              uint32_t set_idx,
+                              uint32_t *ways)
+{
+    (void)cache_system;
+    struct lru_metadata *metadata = (struct lru_metadata *)replacement_policy->data;
+    uint32_t assoc = metadata->associativity;
+    for (uint32_t i = 0; i < assoc; i++) {
+        ways[i] = metadata->order[set_idx][assoc - 1 - i];
+    }
+}
+
 /**
  * Cleanup function for LRU: frees all memory allocated in the metadata structure.
  */
@@ -159,7 +216,10 @@ struct replacement_policy *lru_replacement_policy_new(uint32_t sets, uint32_t as
     // Assign the three function pointers
     policy->eviction_index = lru_eviction_index;
     policy->cache_access   = lru_cache_access;
+    policy->demote         = lru_demote;
+    policy->recency_order  = lru_recency_order;
     policy->cleanup        = lru_replacement_policy_cleanup;
+    policy->set_local      = true;
 
     return policy;
 }
@@ -297,7 +357,213 @@ struct replacement_policy *lru_prefer_clean_replacement_policy_new(uint32_t sets
     // Assign the function pointers
     policy->eviction_index = lru_prefer_clean_eviction_index;
     policy->cache_access   = lru_prefer_clean_cache_access;
+    policy->demote         = lru_demote;
+    policy->recency_order  = lru_recency_order;
     policy->cleanup        = lru_prefer_clean_replacement_policy_cleanup;
+    policy->set_local      = true;
+
+    return policy;
+}
+
+// DIRTY_AWARE Replacement Policy
+// ============================================================================
+// A generalization of LRU and LRU_PREFER_CLEAN. Only the `window` least
+// recently used lines are eviction candidates. A candidate at recency
+// position r (0 is the LRU line) costs r for the expected re-reference miss
+// plus `write_cost` if it is dirty, and the cheapest candidate is evicted
+// (ties go to the least recently used one).
+//
+// Because only the LRU line can be the cheapest dirty candidate, this reduces
+// to: evict the least recently used clean line at a position r < min(window,
+// write_cost), otherwise evict the LRU line. So:
+//  * window = 1 or write_cost = 0 is LRU.
+//  * window = write_cost = associativity is LRU_PREFER_CLEAN.
+
+/**
+ * The LRU metadata must be the first member so that the LRU functions can be
+ * shared.
+ */
+struct dirty_aware_metadata {
+    struct lru_metadata lru;
+    uint32_t window;     // number of LRU positions searched for a clean line
+    uint32_t write_cost; // cost of a write-back, in recency positions
+    // For sets of up to 64 ways: clean[set_idx] has bit r set if the line at
+    // recency position r (0 is the LRU line) is clean. NULL for wider sets.
+    uint64_t *clean;
+};
+
+/**
+ * Find the way of the valid line with the given tag, and its position in the
+ * order array. Returns false if the line is not in the set.
+ */
+static bool dirty_aware_find(struct dirty_aware_metadata *md, struct cache_system *cache_system,
+                             uint32_t set_idx, uint32_t tag, uint32_t *way, uint32_t *p)
+{
+    uint32_t assoc = md->lru.associativity;
+    uint32_t *order = md->lru.order[set_idx];
+    struct cache_line *lines = &cache_system->cache_lines[set_idx * assoc];
+    *way = 0;
+    while (*way < assoc && (lines[*way].tag != tag || lines[*way].status == INVALID)) {
+        (*way)++;
+    }
+    *p = 0;
+    while (*p < assoc && order[*p] != *way) (*p)++;
+    return *way < assoc && *p < assoc;
+}
+
+/**
+ * Same as lru_cache_access, and moves the line's clean bit to the MRU end of
+ * the mask.
+ */
+static void dirty_aware_cache_access(struct replacement_policy *replacement_policy,
+                                     struct cache_system *cache_system,
+                                     uint32_t set_idx,
+                                     uint32_t tag)
+{
+    struct dirty_aware_metadata *md = (struct dirty_aware_metadata *)replacement_policy->data;
+    uint32_t assoc = md->lru.associativity;
+    uint32_t *order = md->lru.order[set_idx];
+    uint32_t way, p;
+    if (!dirty_aware_find(md, cache_system, set_idx, tag, &way, &p)) {
+        return; // Defensive check
+    }
+    for (uint32_t i = p; i > 0; i--) {
+        order[i] = order[i - 1];
+    }
+    order[0] = way;
+
+    if (md->clean) {
+        // The bits above the line's move down by one, and it takes the top.
+        uint64_t mask = md->clean[set_idx];
+        uint32_t b = assoc - 1 - p;
+        uint64_t above = b + 1 < 64 ? (mask >> (b + 1)) << b : 0;
+        bool clean = cache_system->cache_lines[set_idx * assoc + way].status == EXCLUSIVE;
+        md->clean[set_idx] =
+            (mask & ((1ull << b) - 1)) | above | ((uint64_t)clean << (assoc - 1));
+    }
+}
+
+/**
+ * Same as lru_demote, and moves the line's clean bit to the LRU end of the
+ * mask.
+ */
+static void dirty_aware_demote(struct replacement_policy *replacement_policy,
+                               struct cache_system *cache_system,
+                               uint32_t set_idx,
+                               uint32_t tag)
+{
+    struct dirty_aware_metadata *md = (struct dirty_aware_metadata *)replacement_policy->data;
+    uint32_t assoc = md->lru.associativity;
+    uint32_t *order = md->lru.order[set_idx];
+    uint32_t way, p;
+    if (!dirty_aware_find(md, cache_system, set_idx, tag, &way, &p)) {
+        return; // Defensive check
+    }
+    for (uint32_t i = p; i + 1 < assoc; i++) {
+        order[i] = order[i + 1];
+    }
+    order[assoc - 1] = way;
+
+    if (md->clean) {
+        // The bits below the line's move up by one, and it takes bit 0.
+        uint64_t mask = md->clean[set_idx];
+        uint32_t b = assoc - 1 - p;
+        uint64_t below = mask & ((1ull << b) - 1);
+        bool clean = cache_system->cache_lines[set_idx * assoc + way].status == EXCLUSIVE;
+        md->clean[set_idx] = (mask & ~((2ull << b) - 1)) | (below << 1) | clean;
+    }
+}
+
+static uint32_t dirty_aware_eviction_index(struct replacement_policy *replacement_policy,
+                                           struct cache_system *cache_system,
+                                           uint32_t set_idx)
+{
+    struct dirty_aware_metadata *md = (struct dirty_aware_metadata *)replacement_policy->data;
+    uint32_t assoc = md->lru.associativity;
+    uint32_t *order = md->lru.order[set_idx];
+    struct cache_line *lines = &cache_system->cache_lines[set_idx * assoc];
+
+    uint32_t limit = md->window < md->write_cost ? md->window : md->write_cost;
+    if (limit > assoc) limit = assoc;
+
+    // The eager write-back engine cleans lines without telling the policy, so
+    // the mask is only trusted without it.
+    if (md->clean && !cache_system->eager_writeback) {
+        uint64_t window = limit < 64 ? (1ull << limit) - 1 : ~0ull;
+        uint64_t candidates = md->clean[set_idx] & window;
+        if (candidates) {
+            return order[assoc - 1 - __builtin_ctzll(candidates)];
+        }
+        return order[assoc - 1];
+    }
+
+    for (uint32_t r = 0; r < limit; r++) {
+        uint32_t way = order[assoc - 1 - r];
+        if (lines[way].status == EXCLUSIVE) {
+            return way;
+        }
+    }
+
+    // No clean line is cheap enough, evict the LRU line.
+    return order[assoc - 1];
+}
+
+/**
+ * Cleanup for DIRTY_AWARE: the LRU metadata, and the clean masks.
+ */
+static void dirty_aware_replacement_policy_cleanup(struct replacement_policy *replacement_policy)
+{
+    struct dirty_aware_metadata *md = (struct dirty_aware_metadata *)replacement_policy->data;
+    if (!md) return;
+    free(md->clean);
+    lru_replacement_policy_cleanup(replacement_policy);
+}
+
+/**
+ * Constructor for DIRTY_AWARE. The order array is maintained exactly like
+ * LRU, so the LRU recency order function is reused.
+ */
+struct replacement_policy *dirty_aware_replacement_policy_new(uint32_t sets,
+                                                              uint32_t associativity,
+                                                              uint32_t window,
+                                                              uint32_t write_cost)
+{
+    struct replacement_policy *policy =
+        (struct replacement_policy *)malloc(sizeof(struct replacement_policy));
+    if (!policy) {
+        return NULL;
+    }
+
+    struct dirty_aware_metadata *md =
+        (struct dirty_aware_metadata *)malloc(sizeof(struct dirty_aware_metadata));
+    if (!md) {
+        free(policy);
+        return NULL;
+    }
+
+    md->lru.num_sets = sets;
+    md->lru.associativity = associativity;
+    md->window = window;
+    md->write_cost = write_cost;
+    // Every line is invalid, so none is marked clean.
+    md->clean = associativity <= 64 ? (uint64_t *)calloc(sets, sizeof(uint64_t)) : NULL;
+
+    md->lru.order = (uint32_t **)malloc(sizeof(uint32_t *) * sets);
+    for (uint32_t s = 0; s < sets; s++) {
+        md->lru.order[s] = (uint32_t *)malloc(sizeof(uint32_t) * associativity);
+        for (uint32_t i = 0; i < associativity; i++) {
+            md->lru.order[s][i] = i;
+        }
+    }
+
+    policy->data = md;
+
+    policy->eviction_index = dirty_aware_eviction_index;
+    policy->cache_access   = dirty_aware_cache_access;
+    policy->demote         = dirty_aware_demote;
+    policy->recency_order  = lru_recency_order;
+    policy->cleanup        = dirty_aware_replacement_policy_cleanup;
+    policy->set_local      = true;
 
     return policy;
 }
@@ -313,6 +579,9 @@ struct replacement_policy *lru_prefer_clean_replacement_policy_new(uint32_t sets
 struct rand_metadata {
     uint32_t num_sets;
     uint32_t associativity;
+    // Per-set reproducible streams, or NULL to draw from libsodium's global
+    // generator.
+    struct rng_streams *streams;
 };
 
 /**
@@ -323,11 +592,14 @@ static uint32_t rand_eviction_index(struct replacement_policy *replacement_polic
                                     uint32_t set_idx)
 {
     (void)cache_system; // Not used for random
-    (void)set_idx;      // Not used for random
 
     struct rand_metadata *md = (struct rand_metadata *)replacement_policy->data;
     uint32_t assoc = md->associativity;
 
+    if (md->streams) {
+        return rng_streams_uniform(md->streams, set_idx, assoc);
+    }
+
     // arc4random_uniform
     // return arc4random_uniform(assoc); // Only work on my Mac. :(
     return randombytes_uniform(assoc);
@@ -357,6 +629,11 @@ static void rand_replacement_policy_cleanup(struct replacement_policy *replaceme
     if (!replacement_policy || !replacement_policy->data) {
         return;
     }
+    struct rand_metadata *md = (struct rand_metadata *)replacement_policy->data;
+    if (md->streams) {
+        rng_streams_cleanup(md->streams);
+        free(md->streams);
+    }
     free(replacement_policy->data);
     replacement_policy->data = NULL;
 }
@@ -381,6 +658,7 @@ struct replacement_policy *rand_replacement_policy_new(uint32_t sets, uint32_t a
 
     md->num_sets = sets;
     md->associativity = associativity;
+    md->streams = NULL;
 
     policy->data = md;
 
@@ -390,7 +668,56 @@ struct replacement_policy *rand_replacement_policy_new(uint32_t sets, uint32_t a
     // Assign the function pointers
     policy->eviction_index = rand_eviction_index;
     policy->cache_access   = rand_cache_access;
+    policy->demote         = NULL; // There is no recency order to demote within.
+    policy->recency_order  = NULL;
     policy->cleanup        = rand_replacement_policy_cleanup;
+    // All sets draw from one global generator.
+    policy->set_local      = false;
 
     return policy;
-}
\ No newline at end of file
+}
+
+/**
+ * Constructor for RAND with reproducible victims: each set draws from its own
+ * stream for (seed, trial), so the victims do not depend on the order in
+ * which sets are simulated.
+ */
+struct replacement_policy *rand_seeded_replacement_policy_new(uint32_t sets,
+                                                              uint32_t associativity,
+                                                              uint64_t seed,
+                                                              uint32_t trial)
+{
+    struct replacement_policy *policy = rand_replacement_policy_new(sets, associativity);
+    if (!policy) {
+        return NULL;
+    }
+    struct rand_metadata *md = (struct rand_metadata *)policy->data;
+    md->streams = rng_streams_new(seed, trial, sets);
+    policy->set_local = true;
+    return policy;
+}
+
+/**
+ * Instantiate the replacement policy with the given name (see
+ * replacement_policies.h).
+ */
+struct replacement_policy *replacement_policy_new_by_name(const char *name, uint32_t sets,
+                                                          uint32_t associativity)
+{
+    uint32_t window, write_cost;
+    uint64_t seed;
+    int end = 0;
+    if (sscanf(name, "DIRTY_AWARE:%u:%u%n", &window, &write_cost, &end) == 2 &&
+        name[end] == '\0' && window > 0) {
+        return dirty_aware_replacement_policy_new(sets, associativity, window, write_cost);
+    } else if (sscanf(name, "RAND:%" SCNu64, &seed) == 1) {
+        return rand_seeded_replacement_policy_new(sets, associativity, seed, 0);
+    } else if (!strcmp("LRU", name)) {
+        return lru_replacement_policy_new(sets, associativity);
+    } else if (!strcmp("RAND", name)) {
+        return rand_replacement_policy_new(sets, associativity);
+    } else if (!strcmp("LRU_PREFER_CLEAN", name)) {
+        return lru_prefer_clean_replacement_policy_new(sets, associativity);
+    }
+    return NULL;
+}
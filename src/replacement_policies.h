@@ -6,6 +6,7 @@
 #ifndef REPLACEMENT_POLICIES_H
 #define REPLACEMENT_POLICIES_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
@@ -50,6 +51,25 @@ struct replacement_policy {
     void (*cache_access)(struct replacement_policy *replacement_policy,
                          struct cache_system *cache_system, uint32_t set_idx, uint32_t tag);
 
+    // This function is optional (it may be NULL). It is called right after
+    // cache_access when the line is predicted dead, and should make the line
+    // with the given tag the next one to be evicted from the set.
+    //
+    // Argruments: same as cache_access.
+    void (*demote)(struct replacement_policy *replacement_policy,
+                   struct cache_system *cache_system, uint32_t set_idx, uint32_t tag);
+
+    // This function is optional (it may be NULL). It reports the recency
+    // order of a set.
+    //
+    // Argruments:
+    //  * replacement_policy, cache_system, set_idx: same as cache_access.
+    //  * ways: an array of size associativity to fill with the indices
+    //    within the set, from the least recently used to the most recently
+    //    used.
+    void (*recency_order)(struct replacement_policy *replacement_policy,
+                          struct cache_system *cache_system, uint32_t set_idx, uint32_t *ways);
+
     // This function is called right before the replacement policy is
     // deallocated. You should perform any necessary cleanup operations here.
     // (This is where you should free the replacement_policy->data, for
@@ -59,6 +79,10 @@ struct replacement_policy {
     //  * replacement_policy: the instance of replacement_policy to clean up
     void (*cleanup)(struct replacement_policy *replacement_policy);
 
+    // Whether the policy's decisions for a set only depend on the accesses to
+    // that set, so that sets can be simulated in any interleaving.
+    bool set_local;
+
     // Use this pointer to store any data for the replacement policy.
     void *data;
 };
@@ -66,7 +90,26 @@ struct replacement_policy {
 // Constructors for each of the replacement policies.
 struct replacement_policy *lru_replacement_policy_new(uint32_t sets, uint32_t associativity);
 struct replacement_policy *rand_replacement_policy_new(uint32_t sets, uint32_t associativity);
+struct replacement_policy *rand_seeded_replacement_policy_new(uint32_t sets,
+                                                              uint32_t associativity,
+                                                              uint64_t seed,
+                                                              uint32_t trial);
 struct replacement_policy *lru_prefer_clean_replacement_policy_new(uint32_t sets,
                                                                    uint32_t associativity);
 
+// DIRTY_AWARE only looks for clean lines among the `window` least recently
+// used lines, and weighs the write-back of a dirty line as `write_cost`
+// recency positions.
+struct replacement_policy *dirty_aware_replacement_policy_new(uint32_t sets,
+                                                              uint32_t associativity,
+                                                              uint32_t window,
+                                                              uint32_t write_cost);
+
+// Instantiate the replacement policy with the given name (LRU, RAND,
+// LRU_PREFER_CLEAN). DIRTY_AWARE takes its parameters in the name, as
+// DIRTY_AWARE:WINDOW:WRITE_COST, and RAND:SEED is a reproducible RAND (trial
+// 0 of that seed). Returns NULL if the name is unknown.
+struct replacement_policy *replacement_policy_new_by_name(const char *name, uint32_t sets,
+                                                          uint32_t associativity);
+
 #endif
@@ -0,0 +1,216 @@
+//
+// This file contains the implementations for the functions defined in
+// reuse_distance.h.
+//
+// Distances are counted with a Fenwick tree over access times that has a
+// mark at the most recent access time of every line: the distance of a reuse
+// at time t whose previous access was at time p is the number of marks in
+// (p, t).
+//
+
+#include "reuse_distance.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "hash_map.h"
+
+// Fenwick tree
+// ============================================================================
+
+static void fenwick_add(uint32_t *tree, size_t size, size_t i, int32_t delta)
+{
+    for (i++; i <= size; i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+// Returns the number of marks in [0, i).
+static uint32_t fenwick_prefix(const uint32_t *tree, size_t i)
+{
+    uint32_t sum = 0;
+    for (; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+// Chunks
+// ============================================================================
+
+// The first and last reference to a line within a chunk.
+struct reuse_distance_first_ref {
+    uint32_t line;
+    uint32_t first, last;
+};
+
+struct reuse_distance_chunk {
+    const uint32_t *lines;
+    size_t start, end;
+
+    // counts[d] for the reuses resolved within the chunk.
+    uint64_t *counts;
+
+    // The first reference of every line in the chunk, in order.
+    struct reuse_distance_first_ref *first_refs;
+    size_t num_first_refs;
+};
+
+static void *reuse_distance_chunk_run(void *arg)
+{
+    struct reuse_distance_chunk *chunk = arg;
+    size_t size = chunk->end - chunk->start;
+    uint32_t *tree = calloc(size + 1, sizeof(uint32_t));
+    struct hash_map *seen = hash_map_new(1024); // line -> index in first_refs
+
+    chunk->counts = calloc(size, sizeof(uint64_t));
+    chunk->first_refs = malloc(sizeof(struct reuse_distance_first_ref) * size);
+    chunk->num_first_refs = 0;
+
+    for (size_t t = chunk->start; t < chunk->end; t++) {
+        bool inserted;
+        uint64_t *v = hash_map_upsert(seen, chunk->lines[t], &inserted);
+        if (inserted) {
+            *v = chunk->num_first_refs;
+            struct reuse_distance_first_ref fr = {chunk->lines[t], t, t};
+            chunk->first_refs[chunk->num_first_refs++] = fr;
+        } else {
+            struct reuse_distance_first_ref *fr = &chunk->first_refs[*v];
+            size_t p = fr->last - chunk->start;
+            chunk->counts[fenwick_prefix(tree, t - chunk->start) - fenwick_prefix(tree, p + 1)]++;
+            fenwick_add(tree, size, p, -1);
+            fr->last = t;
+        }
+        fenwick_add(tree, size, t - chunk->start, 1);
+    }
+
+    free(tree);
+    hash_map_cleanup(seen);
+    free(seen);
+    return NULL;
+}
+
+// Analysis
+// ============================================================================
+
+struct reuse_distance *reuse_distance_new(void)
+{
+    struct reuse_distance *rd = malloc(sizeof(struct reuse_distance));
+    if (!rd) {
+        return NULL;
+    }
+    rd->count = 0;
+    rd->capacity = 1024;
+    rd->lines = malloc(sizeof(uint32_t) * rd->capacity);
+    rd->counts = NULL;
+    rd->cold = 0;
+    return rd;
+}
+
+void reuse_distance_cleanup(struct reuse_distance *rd)
+{
+    free(rd->lines);
+    free(rd->counts);
+}
+
+void reuse_distance_add(struct reuse_distance *rd, uint32_t line_addr)
+{
+    if (rd->count == rd->capacity) {
+        rd->capacity *= 2;
+        rd->lines = realloc(rd->lines, sizeof(uint32_t) * rd->capacity);
+    }
+    rd->lines[rd->count++] = line_addr;
+}
+
+void reuse_distance_compute(struct reuse_distance *rd, uint32_t threads)
+{
+    size_t n = rd->count;
+    if (threads == 0) threads = 1;
+    if (threads > n) threads = n > 0 ? n : 1;
+
+    struct reuse_distance_chunk *chunks = malloc(sizeof(struct reuse_distance_chunk) * threads);
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    bool *started = malloc(sizeof(bool) * threads);
+    for (uint32_t c = 0; c < threads; c++) {
+        chunks[c].lines = rd->lines;
+        chunks[c].start = n * c / threads;
+        chunks[c].end = n * (c + 1) / threads;
+        // A chunk whose thread cannot be started is resolved on this one.
+        started[c] = pthread_create(&tids[c], NULL, reuse_distance_chunk_run, &chunks[c]) == 0;
+        if (!started[c]) {
+            reuse_distance_chunk_run(&chunks[c]);
+        }
+    }
+
+    free(rd->counts);
+    rd->counts = calloc(n + 1, sizeof(uint64_t));
+    rd->cold = 0;
+
+    // Reconcile the chunks in order. The tree has a mark at the last access
+    // of every line seen in the earlier chunks. While a chunk's first
+    // references are resolved, each line touched so far in the chunk is
+    // marked at its first reference, which lies in (p, t) for any query from
+    // the same chunk. After the chunk, its marks move to its last references.
+    uint32_t *tree = calloc(n + 1, sizeof(uint32_t));
+    struct hash_map *last = hash_map_new(1024); // line -> last access time + 1
+    for (uint32_t c = 0; c < threads; c++) {
+        struct reuse_distance_chunk *chunk = &chunks[c];
+        if (started[c]) {
+            pthread_join(tids[c], NULL);
+        }
+
+        for (size_t i = 0; i < chunk->end - chunk->start; i++) {
+            rd->counts[i] += chunk->counts[i];
+        }
+
+        uint32_t marks = c == 0 ? 0 : fenwick_prefix(tree, chunk->start);
+        for (size_t i = 0; i < chunk->num_first_refs; i++) {
+            struct reuse_distance_first_ref *fr = &chunk->first_refs[i];
+            uint64_t *p = hash_map_get(last, fr->line);
+            if (p) {
+                // All of the marks are before fr->first.
+                rd->counts[marks - fenwick_prefix(tree, *p)]++;
+                fenwick_add(tree, n, *p - 1, -1);
+                marks--;
+            } else {
+                rd->cold++;
+            }
+            fenwick_add(tree, n, fr->first, 1);
+            marks++;
+        }
+        for (size_t i = 0; i < chunk->num_first_refs; i++) {
+            struct reuse_distance_first_ref *fr = &chunk->first_refs[i];
+            fenwick_add(tree, n, fr->first, -1);
+            fenwick_add(tree, n, fr->last, 1);
+            *hash_map_upsert(last, fr->line, NULL) = (uint64_t)fr->last + 1;
+        }
+
+        free(chunk->counts);
+        free(chunk->first_refs);
+    }
+
+    free(tree);
+    hash_map_cleanup(last);
+    free(last);
+    free(chunks);
+    free(tids);
+    free(started);
+}
+
+void reuse_distance_print(struct reuse_distance *rd)
+{
+    uint64_t distinct = rd->cold;
+    printf("OUTPUT REUSE DISTINCT LINES %" PRIu64 "\n", distinct);
+
+    // misses(C) = cold + number of reuses with distance >= C.
+    uint64_t misses = rd->count;
+    size_t d = 0;
+    for (uint64_t lines = 1;; lines *= 2) {
+        for (; d < lines && d < rd->count; d++) {
+            misses -= rd->counts[d];
+        }
+        printf("OUTPUT MRC %" PRIu64 " LINES MISS RATIO %.8f\n", lines,
+               rd->count ? (double)misses / rd->count : 0.0);
+        if (lines >= distinct) break;
+    }
+}
@@ -0,0 +1,47 @@
+//
+// This file defines the structs and function signatures for the reuse
+// (stack) distance analysis. The reuse distance of an access is the number
+// of distinct lines accessed since the previous access to the same line, so
+// a fully-associative LRU cache of C lines hits exactly when it is below C.
+// The histogram of reuse distances gives the miss ratio of every cache size
+// at once (the miss ratio curve).
+//
+// The analysis is split across threads by trace chunks. Each thread resolves
+// the reuses within its chunk and records the first and last reference of
+// every line in it. A sequential reconciliation pass then resolves every
+// chunk's first references using only the earlier chunks' distinct-line
+// sets, which gives exactly the distances of the sequential analysis.
+//
+
+#ifndef REUSE_DISTANCE_H
+#define REUSE_DISTANCE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct reuse_distance {
+    // The line address of every access, in trace order.
+    uint32_t *lines;
+    size_t count, capacity;
+
+    // The result: counts[d] is the number of accesses with reuse distance d,
+    // and cold is the number of first accesses to a line.
+    uint64_t *counts;
+    uint64_t cold;
+};
+
+struct reuse_distance *reuse_distance_new(void);
+void reuse_distance_cleanup(struct reuse_distance *rd);
+
+// Record an access to the given line.
+void reuse_distance_add(struct reuse_distance *rd, uint32_t line_addr);
+
+// Compute the reuse distance histogram of the recorded accesses with the
+// given number of threads. The result does not depend on the thread count.
+void reuse_distance_compute(struct reuse_distance *rd, uint32_t threads);
+
+// Print the histogram summary and the miss ratio curve for fully-associative
+// LRU caches of every power-of-two number of lines.
+void reuse_distance_print(struct reuse_distance *rd);
+
+#endif
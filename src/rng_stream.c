@@ -0,0 +1,86 @@
+//
+// This file contains the implementations for the functions defined in
+// rng_stream.h.
+//
+// Block b of stream s for trial t is generated with libsodium's
+// randombytes_buf_deterministic, seeded with BLAKE2b(seed, t, s, b). Any
+// block can therefore be generated independently of all others.
+//
+
+#include "rng_stream.h"
+#include <sodium.h>
+#include <string.h>
+
+struct rng_streams *rng_streams_new(uint64_t seed, uint32_t trial, uint32_t count)
+{
+    struct rng_streams *rs = malloc(sizeof(struct rng_streams));
+    if (!rs) {
+        return NULL;
+    }
+    rs->seed = seed;
+    rs->trial = trial;
+    rs->count = count;
+    rs->streams = calloc(count, sizeof(struct rng_stream));
+
+    // Start every stream with an empty buffer.
+    for (uint32_t i = 0; i < count; i++) {
+        rs->streams[i].pos = RNG_STREAM_WORDS;
+    }
+    return rs;
+}
+
+void rng_streams_cleanup(struct rng_streams *rs)
+{
+    for (uint32_t i = 0; i < rs->count; i++) {
+        free(rs->streams[i].buf);
+    }
+    free(rs->streams);
+}
+
+static void rng_stream_refill(struct rng_streams *rs, uint32_t stream)
+{
+    struct rng_stream *st = &rs->streams[stream];
+    if (!st->buf) {
+        st->buf = malloc(sizeof(uint32_t) * RNG_STREAM_WORDS);
+    }
+
+    // Little-endian encoding of (seed, trial, stream, block), so that the
+    // streams are the same on every host.
+    unsigned char counter[20];
+    for (int i = 0; i < 8; i++) counter[i] = (unsigned char)(rs->seed >> (8 * i));
+    for (int i = 0; i < 4; i++) counter[8 + i] = (unsigned char)(rs->trial >> (8 * i));
+    for (int i = 0; i < 4; i++) counter[12 + i] = (unsigned char)(stream >> (8 * i));
+    for (int i = 0; i < 4; i++) counter[16 + i] = (unsigned char)(st->block >> (8 * i));
+
+    unsigned char block_seed[randombytes_SEEDBYTES];
+    crypto_generichash(block_seed, sizeof(block_seed), counter, sizeof(counter), NULL, 0);
+
+    unsigned char bytes[sizeof(uint32_t) * RNG_STREAM_WORDS];
+    randombytes_buf_deterministic(bytes, sizeof(bytes), block_seed);
+    for (int i = 0; i < RNG_STREAM_WORDS; i++) {
+        st->buf[i] = (uint32_t)bytes[4 * i] | (uint32_t)bytes[4 * i + 1] << 8 |
+                     (uint32_t)bytes[4 * i + 2] << 16 | (uint32_t)bytes[4 * i + 3] << 24;
+    }
+    st->block++;
+    st->pos = 0;
+}
+
+uint32_t rng_streams_uniform(struct rng_streams *rs, uint32_t stream, uint32_t upper_bound)
+{
+    if (upper_bound < 2) {
+        return 0;
+    }
+
+    // Reject the values below 2^32 mod upper_bound so that the result is
+    // unbiased, the same way randombytes_uniform does.
+    uint32_t min = (1U + ~upper_bound) % upper_bound;
+    struct rng_stream *st = &rs->streams[stream];
+    uint32_t r;
+    do {
+        if (st->pos == RNG_STREAM_WORDS) {
+            rng_stream_refill(rs, stream);
+        }
+        r = st->buf[st->pos++];
+    } while (r < min);
+    return r % upper_bound;
+}
@@ -0,0 +1,43 @@
+//
+// This file defines the structs and function signatures for reproducible,
+// counter-based random number streams. Every (trial, set) pair gets its own
+// stream derived from a master seed, so the numbers a set draws do not depend
+// on how many other sets have drawn before it, or in which order.
+//
+
+#ifndef RNG_STREAM_H
+#define RNG_STREAM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// The words generated per block (1 KiB), so that the cost of seeding a block
+// is spread over many draws.
+#define RNG_STREAM_WORDS 256
+
+// One stream. Its numbers are generated RNG_STREAM_WORDS at a time into buf,
+// which is allocated on the first draw, so that the sets that never draw cost
+// no buffer; block is the index of the next block to generate.
+struct rng_stream {
+    uint32_t *buf;
+    uint32_t block;
+    uint16_t pos;
+};
+
+// The streams of every set for one trial.
+struct rng_streams {
+    uint64_t seed;
+    uint32_t trial;
+    uint32_t count;
+    struct rng_stream *streams;
+};
+
+// Create `count` streams (one per set) for the given master seed and trial.
+struct rng_streams *rng_streams_new(uint64_t seed, uint32_t trial, uint32_t count);
+void rng_streams_cleanup(struct rng_streams *rs);
+
+// Returns a uniformly distributed number in [0, upper_bound) from the given
+// stream.
+uint32_t rng_streams_uniform(struct rng_streams *rs, uint32_t stream, uint32_t upper_bound);
+
+#endif
@@ -0,0 +1,79 @@
+//
+// This file contains the implementations for the functions defined in
+// set_order.h.
+//
+
+#include "set_order.h"
+#include "memory_system.h"
+#include "trace.h"
+
+const char *set_order_check(struct cache_system *cache_system)
+{
+    if (!cache_system->replacement_policy->set_local) {
+        return "the replacement policy is not set-local";
+    }
+    if (cache_system->dead_block_predictor) {
+        return "the dead-block predictor is shared by all sets";
+    }
+    if (cache_system->eager_writeback) {
+        return "the eager write-back engine runs on a global access count";
+    }
+    return NULL;
+}
+
+// A decoded record of the window.
+struct set_order_record {
+    uint32_t address, set_idx, tag;
+    char rw;
+};
+
+int set_order_run(struct cache_system *cache_system, struct trace_splitter *sp, FILE *in,
+                  bool (*read_record)(FILE *, struct trace_record *), size_t window)
+{
+    struct set_order_record *records = malloc(sizeof(struct set_order_record) * window);
+    struct set_order_record *sorted = malloc(sizeof(struct set_order_record) * window);
+    uint32_t *starts = malloc(sizeof(uint32_t) * (cache_system->num_sets + 1));
+    int ret = 0;
+
+    struct trace_record record = {0, 0};
+    bool more = true;
+    while (more && ret == 0) {
+        // Read and decode one window.
+        size_t n = 0;
+        while (n < window &&
+               (more = trace_split_next(sp, in, read_record, cache_system, &record))) {
+            struct set_order_record *r = &records[n++];
+            r->address = record.address;
+            r->rw = record.rw;
+            cache_system_decode(cache_system, record.address, &r->set_idx, &r->tag);
+        }
+
+        // Stable counting sort by set index.
+        for (uint32_t s = 0; s <= cache_system->num_sets; s++) {
+            starts[s] = 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            starts[records[i].set_idx + 1]++;
+        }
+        for (uint32_t s = 0; s < cache_system->num_sets; s++) {
+            starts[s + 1] += starts[s];
+        }
+        for (size_t i = 0; i < n; i++) {
+            sorted[starts[records[i].set_idx]++] = records[i];
+        }
+
+        for (size_t i = 0; i < n && ret == 0; i++) {
+            struct set_order_record *r = &sorted[i];
+            if (cache_system->verbose) {
+                printf("%s at 0x%x\n", trace_access_name(r->rw), r->address);
+            }
+            ret = cache_system_mem_access_decoded(cache_system, r->address, r->set_idx, r->tag,
+                                                  r->rw);
+        }
+    }
+
+    free(records);
+    free(sorted);
+    free(starts);
+    return ret;
+}
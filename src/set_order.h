@@ -0,0 +1,34 @@
+//
+// This file defines the function for simulating a trace in set order: a
+// window of records is bucketed by set index with a stable counting sort,
+// and each bucket is then simulated contiguously, so that consecutive
+// accesses touch the same set's cache lines and policy state.
+//
+// This gives the same results as simulating in trace order only if every
+// set evolves independently of the others, which is the case when the
+// replacement policy is set-local and no per-access engine (dead-block
+// predictor, eager write-back) is attached.
+//
+
+#ifndef SET_ORDER_H
+#define SET_ORDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct cache_system;
+struct trace_record;
+struct trace_splitter;
+
+// Returns NULL if the cache can be simulated in set order, or the reason it
+// cannot.
+const char *set_order_check(struct cache_system *cache_system);
+
+// Simulate the whole input in set order, `window` line accesses (split from
+// the records by `sp`) at a time.
+int set_order_run(struct cache_system *cache_system, struct trace_splitter *sp, FILE *in,
+                  bool (*read_record)(FILE *, struct trace_record *), size_t window);
+
+#endif
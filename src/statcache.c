@@ -0,0 +1,159 @@
+//
+// This file contains the implementations for the functions defined in
+// statcache.h.
+//
+
+#include "statcache.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+
+#define STATCACHE_MAX_ITERATIONS 1000
+#define STATCACHE_TOLERANCE 1e-10
+#define STATCACHE_CURVE_MAX_LINES (1 << 24)
+
+// splitmix64
+static uint64_t statcache_random(struct statcache *sc)
+{
+    uint64_t z = (sc->rng += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// The gap to the next sample is geometric with mean `period`, so that the
+// samples do not alias with loops in the trace.
+static void statcache_schedule(struct statcache *sc)
+{
+    double u = (statcache_random(sc) >> 11) * 0x1.0p-53;
+    sc->next_sample = sc->time + 1 + (uint64_t)(-log1p(-u) * (sc->period - 1));
+}
+
+struct statcache *statcache_new(uint32_t period)
+{
+    struct statcache *sc = malloc(sizeof(struct statcache));
+    if (!sc) {
+        return NULL;
+    }
+    sc->period = period;
+    sc->time = 0;
+    sc->rng = 1;
+    sc->watchpoints = hash_map_new(1024);
+    sc->active = 0;
+    sc->count = 0;
+    sc->capacity = 1024;
+    sc->reuse_times = malloc(sizeof(uint64_t) * sc->capacity);
+    statcache_schedule(sc);
+    return sc;
+}
+
+void statcache_cleanup(struct statcache *sc)
+{
+    hash_map_cleanup(sc->watchpoints);
+    free(sc->watchpoints);
+    free(sc->reuse_times);
+}
+
+void statcache_access(struct statcache *sc, uint32_t line_addr)
+{
+    sc->time++;
+
+    uint64_t *start = sc->active ? hash_map_get(sc->watchpoints, line_addr) : NULL;
+    if (start && *start) {
+        if (sc->count == sc->capacity) {
+            sc->capacity *= 2;
+            sc->reuse_times = realloc(sc->reuse_times, sizeof(uint64_t) * sc->capacity);
+        }
+        sc->reuse_times[sc->count++] = sc->time - (*start - 1);
+        *start = 0;
+        sc->active--;
+    }
+
+    if (sc->time == sc->next_sample) {
+        // A line that is already watched keeps its earlier sample.
+        uint64_t *watch = hash_map_upsert(sc->watchpoints, line_addr, NULL);
+        if (!*watch) {
+            *watch = sc->time + 1;
+            sc->active++;
+        }
+        statcache_schedule(sc);
+    }
+}
+
+static int statcache_compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+void statcache_sort(struct statcache *sc)
+{
+    qsort(sc->reuse_times, sc->count, sizeof(uint64_t), statcache_compare);
+}
+
+double statcache_rand_miss_ratio(struct statcache *sc, uint64_t lines)
+{
+    double n = sc->count + sc->active;
+    if (n == 0) {
+        return 0;
+    }
+    // Iterating from m = 1 decreases monotonically to the largest fixed
+    // point (m = 0 is also one when there are no dangling samples).
+    double log_keep = log1p(-1.0 / lines), m = 1;
+    for (int i = 0; i < STATCACHE_MAX_ITERATIONS; i++) {
+        double misses = sc->active;
+        for (size_t s = 0; s < sc->count; s++) {
+            // Immediate reuses always hit (and 0 * log(0) would be NaN).
+            double evictions = m * (sc->reuse_times[s] - 1);
+            if (evictions > 0) misses -= expm1(log_keep * evictions);
+        }
+        double next = misses / n;
+        bool done = fabs(next - m) < STATCACHE_TOLERANCE;
+        m = next;
+        if (done) break;
+    }
+    return m;
+}
+
+double statstack_lru_miss_ratio(struct statcache *sc, uint64_t lines)
+{
+    double n = sc->count + sc->active;
+    if (n == 0) {
+        return 0;
+    }
+    // Walk the sorted reuse times, integrating the survival function
+    // P(reuse time > i), which is constant between consecutive reuse times.
+    // The first reuse time whose stack distance reaches `lines` misses, and
+    // so does every longer one.
+    double sd = 0;
+    uint64_t prev = 1;
+    for (size_t s = 0; s < sc->count; s++) {
+        uint64_t t = sc->reuse_times[s];
+        // Samples [s, count) and the dangling ones have reuse time >= t,
+        // so P(reuse time > i) = (n - s) / n for prev <= i < t.
+        sd += (double)(t - prev) * (n - s) / n;
+        prev = t;
+        if (sd >= lines) {
+            return (n - s) / n;
+        }
+    }
+    return sc->active / n;
+}
+
+void statcache_print(struct statcache *sc, uint32_t cache_lines, uint32_t line_size)
+{
+    statcache_sort(sc);
+    printf("OUTPUT STATCACHE SAMPLES %" PRIu64 " DANGLING %" PRIu64 "\n", sc->count + sc->active,
+           sc->active);
+    printf("OUTPUT STATCACHE RAND HIT RATIO %.8f\n",
+           1 - statcache_rand_miss_ratio(sc, cache_lines));
+    printf("OUTPUT STATSTACK LRU HIT RATIO %.8f\n", 1 - statstack_lru_miss_ratio(sc, cache_lines));
+    for (uint64_t lines = 1; lines <= STATCACHE_CURVE_MAX_LINES; lines *= 2) {
+        double rand = statcache_rand_miss_ratio(sc, lines);
+        double lru = statstack_lru_miss_ratio(sc, lines);
+        printf("OUTPUT STATCACHE SIZE %" PRIu64 " RAND MISS RATIO %.8f LRU MISS RATIO %.8f\n",
+               lines * line_size, rand, lru);
+        // Past the footprint, every reuse hits.
+        if (lru <= (double)sc->active / (sc->count + sc->active)) break;
+    }
+}
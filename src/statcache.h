@@ -0,0 +1,64 @@
+//
+// This file defines the structs and function signatures for the statistical
+// cache models. One in about `period` accesses is sampled, like setting a
+// watchpoint on its line, and the sample records the reuse time: the number
+// of accesses until the line is accessed again (samples never reused are
+// dangling). From these sparse samples:
+//
+//  * StatCache (Berg and Hagersten) estimates the miss ratio m of a random
+//    replacement cache of L lines as the fixed point of
+//        m = (dangling + sum over samples of 1 - (1 - 1/L)^(m * (t - 1))) / n
+//    where t - 1 is the number of accesses between the sample and its reuse,
+//    each of which misses with probability m and then evicts the line with
+//    probability 1/L.
+//
+//  * StatStack (Eklov and Hagersten) estimates the LRU stack distance of a
+//    reuse time t as the expected number of the t - 1 intervening accesses
+//    whose own reuse reaches past the end of the window:
+//        SD(t) = sum for i in 1..t-1 of P(reuse time > i)
+//    and a fully-associative LRU cache of L lines misses when SD(t) >= L.
+//
+// Both model fully-associative caches; with random indexing, a set-
+// associative cache of the same size behaves about the same.
+//
+
+#ifndef STATCACHE_H
+#define STATCACHE_H
+
+#include "hash_map.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct statcache {
+    uint32_t period; // Mean number of accesses between samples.
+    uint64_t time;   // Accesses so far.
+    uint64_t next_sample;
+    uint64_t rng;
+
+    // The lines being watched, mapped to the time of the sample plus one
+    // (0 once the watchpoint has fired).
+    struct hash_map *watchpoints;
+    uint64_t active;
+
+    // The reuse times of the samples that fired.
+    uint64_t *reuse_times;
+    size_t count, capacity;
+};
+
+struct statcache *statcache_new(uint32_t period);
+void statcache_cleanup(struct statcache *sc);
+
+void statcache_access(struct statcache *sc, uint32_t line_addr);
+
+// The modeled miss ratios of caches of `lines` lines. statcache_sort must be
+// called once after the last access.
+void statcache_sort(struct statcache *sc);
+double statcache_rand_miss_ratio(struct statcache *sc, uint64_t lines);
+double statstack_lru_miss_ratio(struct statcache *sc, uint64_t lines);
+
+// Print the sample counts, the modeled hit ratios of the simulated cache and
+// the miss ratio curves of both models.
+void statcache_print(struct statcache *sc, uint32_t cache_lines, uint32_t line_size);
+
+#endif
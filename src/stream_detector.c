@@ -0,0 +1,178 @@
+//
+// This file contains the implementations for the functions defined in
+// stream_detector.h.
+//
+
+#include "stream_detector.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+#define STREAM_TOP_STRIDES 4
+
+static const char *stream_region_names[STREAM_REGIONS] = {"STACK", "HEAP", "MMAP"};
+
+static enum stream_region stream_region_classify(uint64_t address)
+{
+    if (address > UINT32_MAX) {
+        // x86-64: the stack is at the top of the user half, the mappings
+        // just below it, and PIE binaries and their heap at 0x55...
+        if (address >= 0x7ff000000000ULL) return STREAM_REGION_STACK;
+        if (address >= 0x7f0000000000ULL) return STREAM_REGION_MMAP;
+        return STREAM_REGION_HEAP;
+    }
+    // i386: the stack below 0xc0000000, the binary at 0x08048000 followed by
+    // the heap, and the mappings in between.
+    if (address >= 0xbf000000) return STREAM_REGION_STACK;
+    if (address >= 0x08000000 && address < 0x20000000) return STREAM_REGION_HEAP;
+    return STREAM_REGION_MMAP;
+}
+
+struct stream_detector *stream_detector_new(uint32_t entries)
+{
+    struct stream_detector *sd = malloc(sizeof(struct stream_detector));
+    if (!sd) {
+        return NULL;
+    }
+    sd->entries = calloc(entries, sizeof(struct stream_entry));
+    sd->num_entries = entries;
+    sd->time = 0;
+    for (int r = 0; r < STREAM_REGIONS; r++) {
+        struct stream_region_stats stats = {0};
+        stats.strides = hash_map_new(64);
+        sd->regions[r] = stats;
+    }
+    return sd;
+}
+
+void stream_detector_cleanup(struct stream_detector *sd)
+{
+    free(sd->entries);
+    for (int r = 0; r < STREAM_REGIONS; r++) {
+        hash_map_cleanup(sd->regions[r].strides);
+        free(sd->regions[r].strides);
+    }
+}
+
+// Record the end of the run of accesses with the entry's current stride.
+static void stream_end(struct stream_detector *sd, struct stream_entry *e)
+{
+    if (!e->valid || e->length <= STREAM_CONFIRM) {
+        return;
+    }
+    struct stream_region_stats *stats = &sd->regions[e->region];
+    uint32_t bucket = 0;
+    while (bucket + 1 < STREAM_LENGTH_BUCKETS && (2u << bucket) <= e->length) bucket++;
+    stats->streams++;
+    stats->lengths[bucket]++;
+}
+
+void stream_detector_access(struct stream_detector *sd, uint64_t address)
+{
+    sd->time++;
+    enum stream_region region = stream_region_classify(address);
+    struct stream_region_stats *stats = &sd->regions[region];
+    stats->accesses++;
+
+    // Find the stream that predicted this address, or else the nearest one.
+    // Otherwise replace the least recently used entry.
+    struct stream_entry *match = NULL, *victim = &sd->entries[0];
+    uint64_t nearest = STREAM_MAX_STRIDE + 1;
+    for (uint32_t i = 0; i < sd->num_entries; i++) {
+        struct stream_entry *e = &sd->entries[i];
+        if (!e->valid) {
+            if (victim->valid) victim = e;
+            continue;
+        }
+        if (e->stride != 0 && e->last_address + e->stride == address) {
+            match = e;
+            break;
+        }
+        uint64_t distance =
+            address > e->last_address ? address - e->last_address : e->last_address - address;
+        if (distance < nearest) {
+            nearest = distance;
+            match = e;
+        }
+        if (victim->valid && e->last_used < victim->last_used) victim = e;
+    }
+
+    if (!match) {
+        stream_end(sd, victim);
+        struct stream_entry entry = {address, 0, 1, sd->time, region, true};
+        *victim = entry;
+        return;
+    }
+
+    match->last_used = sd->time;
+    int64_t stride = (int64_t)(address - match->last_address);
+    if (stride == 0) {
+        // A repeated access neither extends nor breaks the stream.
+        return;
+    }
+    if (stride == match->stride) {
+        match->length++;
+    } else {
+        stream_end(sd, match);
+        match->stride = stride;
+        match->length = 2;
+        match->region = region;
+    }
+    match->last_address = address;
+
+    // Once the stride is confirmed, the accesses that established it count
+    // as part of the stream too.
+    uint32_t counted = match->length == STREAM_CONFIRM + 1 ? match->length
+                       : match->length > STREAM_CONFIRM   ? 1
+                                                          : 0;
+    if (counted) {
+        stats->stream_accesses += counted;
+        *hash_map_upsert(stats->strides, (uint64_t)stride, NULL) += counted;
+    }
+}
+
+void stream_detector_print(struct stream_detector *sd)
+{
+    for (uint32_t i = 0; i < sd->num_entries; i++) {
+        stream_end(sd, &sd->entries[i]);
+        sd->entries[i].valid = false;
+    }
+
+    for (int r = 0; r < STREAM_REGIONS; r++) {
+        struct stream_region_stats *stats = &sd->regions[r];
+        const char *name = stream_region_names[r];
+        if (stats->accesses == 0) {
+            continue;
+        }
+        printf("OUTPUT STREAM %s ACCESSES %" PRIu64 " IN STREAMS %" PRIu64 " (%.4f) "
+               "STREAMS %" PRIu64 "\n",
+               name, stats->accesses, stats->stream_accesses,
+               (double)stats->stream_accesses / stats->accesses, stats->streams);
+
+        // The most common strides, by accesses. Each one is zeroed once
+        // printed, so the next pass finds the runner-up.
+        struct hash_map *strides = stats->strides;
+        for (int k = 0; k < STREAM_TOP_STRIDES; k++) {
+            size_t best = strides->capacity;
+            for (size_t i = 0; i < strides->capacity; i++) {
+                if (strides->used[i] && strides->entries[i].value > 0 &&
+                    (best == strides->capacity ||
+                     strides->entries[i].value > strides->entries[best].value)) {
+                    best = i;
+                }
+            }
+            if (best == strides->capacity) {
+                break;
+            }
+            printf("OUTPUT STREAM %s STRIDE %" PRId64 " ACCESSES %" PRIu64 "\n", name,
+                   (int64_t)strides->entries[best].key, strides->entries[best].value);
+            strides->entries[best].value = 0;
+        }
+
+        for (int b = 0; b < STREAM_LENGTH_BUCKETS; b++) {
+            if (stats->lengths[b]) {
+                printf("OUTPUT STREAM %s LENGTH %u+ COUNT %" PRIu64 "\n", name, 1u << b,
+                       stats->lengths[b]);
+            }
+        }
+    }
+}
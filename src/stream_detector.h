@@ -0,0 +1,68 @@
+//
+// This file defines the structs and function signatures for the stream
+// detector, which characterizes the access patterns of a trace before a
+// prefetcher is chosen. Like a reference prediction table, it tracks a bounded
+// number of streams, each with its last address and stride. The traces have
+// no PC, so an access is matched to the stream that predicted it, or else to
+// the nearest stream within STREAM_MAX_STRIDE bytes.
+//
+
+#ifndef STREAM_DETECTOR_H
+#define STREAM_DETECTOR_H
+
+#include "hash_map.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define STREAM_MAX_STRIDE 4096
+
+// A stride is confirmed, and the accesses count as a stream, once it has been
+// seen this many times in a row.
+#define STREAM_CONFIRM 2
+
+// Stream lengths are counted in power-of-two buckets up to 2^(BUCKETS - 1).
+#define STREAM_LENGTH_BUCKETS 16
+
+// The address regions of a process, guessed from the usual Linux layout.
+enum stream_region {
+    STREAM_REGION_STACK,
+    STREAM_REGION_HEAP, // The binary and the brk heap
+    STREAM_REGION_MMAP, // Shared libraries and other mappings
+    STREAM_REGIONS
+};
+
+struct stream_entry {
+    uint64_t last_address;
+    int64_t stride;
+    uint32_t length; // Accesses since the stride last changed, plus one.
+    uint64_t last_used;
+    enum stream_region region;
+    bool valid;
+};
+
+struct stream_region_stats {
+    uint64_t accesses;
+    uint64_t stream_accesses; // Accesses belonging to a confirmed stream
+    uint64_t streams;         // Number of confirmed streams
+    uint64_t lengths[STREAM_LENGTH_BUCKETS];
+    struct hash_map *strides; // Stride -> stream accesses with that stride
+};
+
+struct stream_detector {
+    struct stream_entry *entries;
+    uint32_t num_entries;
+    uint64_t time;
+    struct stream_region_stats regions[STREAM_REGIONS];
+};
+
+// Create a stream detector tracking at most `entries` streams at a time.
+struct stream_detector *stream_detector_new(uint32_t entries);
+void stream_detector_cleanup(struct stream_detector *sd);
+
+void stream_detector_access(struct stream_detector *sd, uint64_t address);
+
+// End the streams still being tracked and print the statistics.
+void stream_detector_print(struct stream_detector *sd);
+
+#endif
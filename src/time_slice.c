@@ -0,0 +1,320 @@
+//
+// This file contains the implementations for the functions defined in
+// time_slice.h.
+//
+
+#include "time_slice.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "memory_system.h"
+#include "replacement_policies.h"
+#include "trace.h"
+
+// Every TIME_SLICE_INDEX_STRIDE-th record: where it starts in the file, and
+// the record before it, which the parser needs to resume (see trace_read).
+struct time_slice_index_entry {
+    long offset;
+    struct trace_record previous;
+};
+
+struct time_slice_index {
+    struct time_slice_index_entry *entries;
+    size_t count;
+    size_t records;
+};
+
+struct time_slice_thread {
+    // Inputs
+    const char *map;
+    size_t map_size;
+    struct time_slice_index *index;
+    bool (*read_record)(FILE *, struct trace_record *);
+    struct cache_system *geometry;
+    const char *policy;
+    size_t warm_start, start, end;
+    size_t next_warm_start, next_end; // The next slice, if there is one
+
+    // Outputs
+    struct cache_system_stats stats;
+    struct trace_splitter splitter; // Over the records of the slice
+    // Over the first records of the next slice, until the two caches
+    // converged: the misses and dirty evictions of this thread's cache, and
+    // of its copy of the next thread's.
+    uint32_t check_misses, check_dirty_evictions;
+    uint32_t next_misses, next_dirty_evictions;
+    bool converged;
+    int ret;
+};
+
+static bool time_slice_index_build(struct time_slice_index *index, FILE *in,
+                                   bool (*read_record)(FILE *, struct trace_record *))
+{
+    size_t capacity = 64;
+    index->entries = malloc(sizeof(struct time_slice_index_entry) * capacity);
+    index->count = 0;
+    index->records = 0;
+    struct trace_record record = {0, 0};
+    for (;;) {
+        long offset = ftell(in);
+        if (offset < 0) {
+            return false;
+        }
+        struct trace_record previous = record;
+        if (!read_record(in, &record)) {
+            break;
+        }
+        if (index->records % TIME_SLICE_INDEX_STRIDE == 0) {
+            if (index->count == capacity) {
+                capacity *= 2;
+                index->entries =
+                    realloc(index->entries, sizeof(struct time_slice_index_entry) * capacity);
+            }
+            struct time_slice_index_entry entry = {offset, previous};
+            index->entries[index->count++] = entry;
+        }
+        index->records++;
+    }
+    return true;
+}
+
+static struct cache_system *time_slice_cache_new(struct time_slice_thread *t)
+{
+    struct cache_system *geometry = t->geometry;
+    struct cache_system *cache_system =
+        cache_system_new(geometry->line_size, geometry->num_sets, geometry->associativity);
+    cache_system->verbose = false;
+    cache_system->replacement_policy = replacement_policy_new_by_name(
+        t->policy, cache_system->num_sets, cache_system->associativity);
+    return cache_system;
+}
+
+// Whether the two caches hold the same lines in the same states, whatever
+// their ways and recency order.
+static bool time_slice_same_contents(struct cache_system *a, struct cache_system *b)
+{
+    uint32_t assoc = a->associativity;
+    for (uint32_t set = 0; set < a->num_sets; set++) {
+        struct cache_line *x = &a->cache_lines[set * assoc];
+        struct cache_line *y = &b->cache_lines[set * assoc];
+        int32_t valid = 0; // Valid lines in y, less those in x
+        for (uint32_t i = 0; i < assoc; i++) {
+            valid += y[i].status != INVALID;
+            if (x[i].status == INVALID) {
+                continue;
+            }
+            valid--;
+            uint32_t j = 0;
+            while (j < assoc && (y[j].tag != x[i].tag || y[j].status != x[i].status)) {
+                j++;
+            }
+            if (j == assoc) {
+                return false;
+            }
+        }
+        if (valid != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void *time_slice_thread_run(void *arg)
+{
+    struct time_slice_thread *t = arg;
+    struct cache_system *cache_system = time_slice_cache_new(t);
+    // The copy of the next thread's cache, warmed on the same records.
+    struct cache_system *next = t->next_end > t->end ? time_slice_cache_new(t) : NULL;
+
+    // Seek to the last indexed record at or before the warmup.
+    struct time_slice_index_entry *entry =
+        &t->index->entries[t->warm_start / TIME_SLICE_INDEX_STRIDE];
+    FILE *in = fmemopen((void *)t->map, t->map_size, "rb");
+    if (!in) {
+        t->ret = 1;
+        cache_system_cleanup(cache_system);
+        free(cache_system);
+        if (next) {
+            cache_system_cleanup(next);
+            free(next);
+        }
+        return NULL;
+    }
+    fseek(in, entry->offset, SEEK_SET);
+    struct trace_record record = entry->previous;
+    size_t i = t->warm_start / TIME_SLICE_INDEX_STRIDE * TIME_SLICE_INDEX_STRIDE;
+    for (; i < t->warm_start; i++) {
+        t->read_record(in, &record);
+    }
+
+    // Every record is split into line accesses, which go to the same slice.
+    struct trace_splitter splitter;
+    struct trace_record access;
+    trace_splitter_init(&splitter);
+    struct cache_system_stats zero = {0, 0, 0, 0};
+    t->ret = 0;
+    t->converged = false;
+    for (; i < t->next_end && t->ret == 0; i++) {
+        if (i == t->start) {
+            cache_system->stats = zero; // The warmup is not counted.
+            trace_splitter_init(&splitter);
+        }
+        if (i == t->end) {
+            t->stats = cache_system->stats;
+            t->splitter = splitter;
+            next->stats = zero;
+        }
+        if (i >= t->end && (i - t->end) % TIME_SLICE_CONVERGE_STRIDE == 0 &&
+            time_slice_same_contents(cache_system, next)) {
+            t->converged = true;
+            break;
+        }
+        if (!t->read_record(in, &record)) {
+            break;
+        }
+        trace_splitter_feed(&splitter, cache_system, &record);
+        while (t->ret == 0 && trace_splitter_take(&splitter, cache_system, &access)) {
+            t->ret = cache_system_mem_access(cache_system, access.address, access.rw);
+            if (next && i >= t->next_warm_start && t->ret == 0) {
+                t->ret = cache_system_mem_access(next, access.address, access.rw);
+            }
+        }
+    }
+    if (!next) {
+        t->stats = cache_system->stats;
+        t->splitter = splitter;
+    } else {
+        t->check_misses = cache_system->stats.misses - t->stats.misses;
+        t->check_dirty_evictions = cache_system->stats.dirty_evictions - t->stats.dirty_evictions;
+        t->next_misses = next->stats.misses;
+        t->next_dirty_evictions = next->stats.dirty_evictions;
+        cache_system_cleanup(next);
+        free(next);
+    }
+
+    fclose(in);
+    cache_system_cleanup(cache_system);
+    free(cache_system);
+    return NULL;
+}
+
+int time_slice_run(struct cache_system *cache_system, struct trace_splitter *sp,
+                   const char *policy, FILE *in,
+                   bool (*read_record)(FILE *, struct trace_record *), uint32_t slices,
+                   size_t warmup)
+{
+    struct stat st;
+    if (fstat(fileno(in), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        fprintf(stderr, "--time-slices needs the trace redirected from a file\n");
+        return 1;
+    }
+    const char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    // Index the trace through a stream over the mapping, starting wherever
+    // `in` is (after the header of a filtered trace).
+    FILE *indexed = fmemopen((void *)map, st.st_size, "rb");
+    if (!indexed) {
+        perror("fmemopen");
+        munmap((void *)map, st.st_size);
+        return 1;
+    }
+    fseek(indexed, ftell(in), SEEK_SET);
+    struct time_slice_index index;
+    bool indexed_ok = time_slice_index_build(&index, indexed, read_record);
+    fclose(indexed);
+    if (!indexed_ok) {
+        fprintf(stderr, "Failed to index the trace\n");
+        free(index.entries);
+        munmap((void *)map, st.st_size);
+        return 1;
+    }
+
+    size_t records = index.records;
+    if (slices > records) {
+        slices = records ? records : 1;
+    }
+    struct time_slice_thread *threads = calloc(slices, sizeof(struct time_slice_thread));
+    pthread_t *tids = malloc(sizeof(pthread_t) * slices);
+    bool *started = malloc(sizeof(bool) * slices);
+    if (!threads || !tids || !started) {
+        fprintf(stderr, "Failed to allocate %u time slices\n", slices);
+        free(threads);
+        free(tids);
+        free(started);
+        free(index.entries);
+        munmap((void *)map, st.st_size);
+        return 1;
+    }
+    for (uint32_t s = 0; s < slices; s++) {
+        struct time_slice_thread *t = &threads[s];
+        t->map = map;
+        t->map_size = st.st_size;
+        t->index = &index;
+        t->read_record = read_record;
+        t->geometry = cache_system;
+        t->policy = policy;
+        t->start = records * s / slices;
+        t->end = records * (s + 1) / slices;
+        t->warm_start = t->start > warmup ? t->start - warmup : 0;
+        t->next_warm_start = t->end > warmup ? t->end - warmup : 0;
+        t->next_end = s + 1 < slices ? records * (s + 2) / slices : t->end;
+    }
+    // A slice whose thread cannot be started is simulated on this one, after
+    // the others have been started.
+    for (uint32_t s = 0; s < slices; s++) {
+        started[s] = pthread_create(&tids[s], NULL, time_slice_thread_run, &threads[s]) == 0;
+    }
+    for (uint32_t s = 0; s < slices; s++) {
+        if (!started[s]) {
+            time_slice_thread_run(&threads[s]);
+        }
+    }
+
+    struct cache_system_stats total = {0, 0, 0, 0};
+    uint64_t miss_error = 0, dirty_error = 0;
+    uint32_t converged = 0;
+    int ret = 0;
+    for (uint32_t s = 0; s < slices; s++) {
+        if (started[s]) {
+            pthread_join(tids[s], NULL);
+        }
+    }
+    printf("OUTPUT TIME SLICES %u WARMUP %zu RECORDS %zu\n", slices, warmup, records);
+    for (uint32_t s = 0; s < slices; s++) {
+        struct time_slice_thread *t = &threads[s];
+        ret |= t->ret;
+        total.accesses += t->stats.accesses;
+        total.hits += t->stats.hits;
+        total.misses += t->stats.misses;
+        total.dirty_evictions += t->stats.dirty_evictions;
+        trace_splitter_merge(sp, &t->splitter);
+        if (s + 1 < slices) {
+            uint32_t a = t->check_misses, b = t->next_misses;
+            miss_error += a > b ? a - b : b - a;
+            a = t->check_dirty_evictions;
+            b = t->next_dirty_evictions;
+            dirty_error += a > b ? a - b : b - a;
+            converged += t->converged;
+        }
+        printf("OUTPUT TIME SLICE %u ACCESSES %u MISSES %u\n", s, t->stats.accesses,
+               t->stats.misses);
+    }
+    printf("OUTPUT TIME SLICE MISS ERROR LOWER BOUND %" PRIu64 " (HIT RATIO +/- %.8f)\n",
+           miss_error, total.accesses ? (double)miss_error / total.accesses : 0.0);
+    printf("OUTPUT TIME SLICE DIRTY EVICTION ERROR LOWER BOUND %" PRIu64 "\n", dirty_error);
+    printf("OUTPUT TIME SLICE BOUNDARIES CONVERGED %u OF %u\n", converged, slices - 1);
+    cache_system->stats = total;
+
+    free(threads);
+    free(tids);
+    free(started);
+    free(index.entries);
+    munmap((void *)map, st.st_size);
+    return ret;
+}
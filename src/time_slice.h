@@ -0,0 +1,55 @@
+//
+// This file defines the function for simulating a trace in parallel time
+// slices. The trace is split into T slices of consecutive records, and every
+// slice is simulated by its own thread on its own copy of the cache. The
+// state at the start of a slice is unknown, so each thread first functionally
+// warms its cache on the WARMUP records before its slice (simulating them
+// without counting them). The statistics of the slices are summed.
+//
+// The warmup cannot rebuild the state exactly, so the error it adds at every
+// boundary is measured. The thread of the previous slice also warms a second
+// cache exactly like the next thread warms its own, and at the end of its
+// slice it runs both caches on into the next slice, in lockstep: its own, and
+// the copy of the next thread's. Once their contents are the same (checked
+// every TIME_SLICE_CONVERGE_STRIDE records), they make the same misses from
+// then on, so the difference in misses up to there is the error of the
+// boundary. If they have not converged by the end of the next slice, the
+// difference over the whole slice is used, and the boundary is reported as
+// unconverged.
+//
+// The cache of the previous thread was itself only warmed on WARMUP records,
+// not run from the start of the trace, so a boundary's error leaves out what
+// is carried over from the earlier boundaries. The sum is therefore reported
+// as a lower bound of the warmup error, not as an estimate of it.
+//
+// A sparse index of the trace (the file offset and parser state every
+// TIME_SLICE_INDEX_STRIDE records) lets every thread seek straight to the
+// start of its warmup.
+//
+
+#ifndef TIME_SLICE_H
+#define TIME_SLICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TIME_SLICE_INDEX_STRIDE 4096
+#define TIME_SLICE_CONVERGE_STRIDE 1024
+
+struct cache_system;
+struct trace_record;
+struct trace_splitter;
+
+// Simulate the rest of `in`, which must be a regular file, in `slices`
+// slices on the caches of the given geometry and policy. There are at most
+// as many slices as records. The summed statistics are stored in
+// cache_system->stats, and the access size statistics of the records are
+// added to `sp`. Returns nonzero on error.
+int time_slice_run(struct cache_system *cache_system, struct trace_splitter *sp,
+                   const char *policy, FILE *in,
+                   bool (*read_record)(FILE *, struct trace_record *), uint32_t slices,
+                   size_t warmup);
+
+#endif
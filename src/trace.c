@@ -0,0 +1,190 @@
+//
+// This file contains the implementations for the functions defined in
+// trace.h.
+//
+
+#include "trace.h"
+#include <inttypes.h>
+#include <string.h>
+#include "memory_system.h"
+
+bool trace_read(FILE *in, struct trace_record *record)
+{
+    // Reading the full width and truncating matches what "%x" stores.
+    int ret = fscanf(in, "%c %" SCNx64, &record->rw, &record->full_address);
+    record->address = (uint32_t)record->full_address;
+
+    // An optional size may follow on the same line. Skipping whitespace
+    // afterwards is what the "\n" of the original format did.
+    record->size = 1;
+    int c;
+    while ((c = getc(in)) == ' ' || c == '\t');
+    if (c != EOF) ungetc(c, in);
+    if (c >= '0' && c <= '9') {
+        uint64_t size = 0;
+        fscanf(in, "%" SCNu64, &size);
+        if (size == 0 || size > TRACE_MAX_SIZE) {
+            fprintf(stderr, "Access size %" PRIu64 " at address %" PRIx64
+                    " is not between 1 and %d\n", size, record->full_address, TRACE_MAX_SIZE);
+            exit(1);
+        }
+        record->size = (uint32_t)size;
+    }
+    fscanf(in, " ");
+    return ret >= 0;
+}
+
+bool trace_filtered_read_header(FILE *in, struct filtered_trace_header *header)
+{
+    return fread(header, sizeof(struct filtered_trace_header), 1, in) == 1 &&
+           !memcmp(header->magic, FILTERED_TRACE_MAGIC, sizeof(header->magic));
+}
+
+bool trace_filtered_read(FILE *in, struct trace_record *record)
+{
+    struct filtered_trace_record r;
+    if (fread(&r, sizeof(r), 1, in) != 1) {
+        return false;
+    }
+    record->address = r.address;
+    record->full_address = r.address;
+    record->size = 1;
+    record->rw = r.rw;
+    return true;
+}
+
+void trace_splitter_init(struct trace_splitter *sp)
+{
+    memset(sp, 0, sizeof(struct trace_splitter));
+}
+
+void trace_splitter_feed(struct trace_splitter *sp, struct cache_system *cache_system,
+                         const struct trace_record *record)
+{
+    sp->whole = *record;
+    sp->record = *record;
+    sp->remaining = record->size ? record->size : 1;
+    sp->whole.size = sp->remaining;
+    sp->records++;
+    sp->bytes += sp->remaining;
+    sp->sized |= sp->remaining != 1;
+
+    // The common case: the access fits in its line.
+    uint32_t offset = cache_system_line_offset(cache_system, record->address);
+    if (offset + sp->remaining > cache_system->line_size) {
+        sp->crossing++;
+    }
+}
+
+bool trace_splitter_take(struct trace_splitter *sp, struct cache_system *cache_system,
+                         struct trace_record *access)
+{
+    if (sp->remaining == 0) {
+        return false;
+    }
+    // The rest of a split access starts at a line boundary.
+    uint32_t line_size = cache_system->line_size;
+    uint32_t offset = cache_system_line_offset(cache_system, sp->record.address);
+    uint32_t bytes = line_size - offset < sp->remaining ? line_size - offset : sp->remaining;
+    *access = sp->record;
+    access->size = bytes;
+    sp->first = sp->remaining == sp->whole.size;
+    sp->record.address += bytes;
+    sp->record.full_address += bytes;
+    sp->remaining -= bytes;
+
+    uint32_t bucket = 0;
+    while (bucket + 1 < TRACE_SIZE_BUCKETS && (2u << bucket) <= bytes) bucket++;
+    sp->line_bytes[bucket]++;
+    sp->line_accesses++;
+    return true;
+}
+
+bool trace_split_next(struct trace_splitter *sp, FILE *in,
+                      bool (*read_record)(FILE *, struct trace_record *),
+                      struct cache_system *cache_system, struct trace_record *access)
+{
+    if (sp->remaining == 0) {
+        struct trace_record record = sp->record;
+        if (!read_record(in, &record)) {
+            return false;
+        }
+        trace_splitter_feed(sp, cache_system, &record);
+    }
+    return trace_splitter_take(sp, cache_system, access);
+}
+
+void trace_splitter_merge(struct trace_splitter *sp, const struct trace_splitter *other)
+{
+    sp->sized |= other->sized;
+    sp->records += other->records;
+    sp->crossing += other->crossing;
+    sp->line_accesses += other->line_accesses;
+    sp->bytes += other->bytes;
+    for (int b = 0; b < TRACE_SIZE_BUCKETS; b++) {
+        sp->line_bytes[b] += other->line_bytes[b];
+    }
+}
+
+void trace_splitter_print(struct trace_splitter *sp)
+{
+    if (!sp->sized) {
+        return;
+    }
+    printf("OUTPUT LINE CROSSING ACCESSES %" PRIu64 " OF %" PRIu64 "\n", sp->crossing,
+           sp->records);
+    printf("OUTPUT LINE ACCESSES %" PRIu64 " BYTES PER LINE ACCESS %.4f\n", sp->line_accesses,
+           (double)sp->bytes / sp->line_accesses);
+    for (int b = 0; b < TRACE_SIZE_BUCKETS; b++) {
+        if (!sp->line_bytes[b]) {
+            continue;
+        }
+        if (b + 1 < TRACE_SIZE_BUCKETS) {
+            printf("OUTPUT LINE ACCESS BYTES %u-%u COUNT %" PRIu64 "\n", 1u << b, (2u << b) - 1,
+                   sp->line_bytes[b]);
+        } else {
+            printf("OUTPUT LINE ACCESS BYTES %u+ COUNT %" PRIu64 "\n", 1u << b,
+                   sp->line_bytes[b]);
+        }
+    }
+}
+
+struct trace_runs *trace_runs_collapse(struct trace_splitter *sp, FILE *in,
+                                       struct cache_system *cache_system)
+{
+    struct trace_runs *runs = malloc(sizeof(struct trace_runs));
+    if (!runs) {
+        return NULL;
+    }
+    runs->count = 0;
+    runs->capacity = 1024;
+    runs->runs = malloc(sizeof(struct trace_run) * runs->capacity);
+    runs->accesses = 0;
+
+    struct trace_record record = {0, 0};
+    struct trace_run *last = NULL;
+    while (trace_split_next(sp, in, trace_read, cache_system, &record)) {
+        runs->accesses++;
+        uint32_t line_addr = cache_system_line_addr(cache_system, record.address);
+        if (last && last->line_addr == line_addr && last->count < UINT32_MAX) {
+            last->count++;
+            last->write |= record.rw == 'W';
+            continue;
+        }
+
+        if (runs->count == runs->capacity) {
+            runs->capacity *= 2;
+            runs->runs = realloc(runs->runs, sizeof(struct trace_run) * runs->capacity);
+        }
+        last = &runs->runs[runs->count++];
+        last->line_addr = line_addr;
+        last->count = 1;
+        last->write = record.rw == 'W';
+    }
+    return runs;
+}
+
+void trace_runs_cleanup(struct trace_runs *runs)
+{
+    free(runs->runs);
+}
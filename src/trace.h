@@ -0,0 +1,136 @@
+//
+// This file defines the structs and function signatures for reading traces,
+// and for preprocessing them into runs of accesses to the same cache line.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct cache_system;
+
+// One access from the trace.
+struct trace_record {
+    char rw;
+    uint32_t address; // The low 32 bits of the address, which are simulated.
+    // The address as written in the trace, for the analyses that classify
+    // accesses by address region (64-bit traces lose it in `address`).
+    uint64_t full_address;
+    uint32_t size; // The number of bytes accessed (1 if the trace has no size).
+};
+
+// The largest access size accepted in a trace (a page).
+#define TRACE_MAX_SIZE 4096
+
+// Read the next record from the trace. Returns false at the end of the input.
+// A record is `R|W|I ADDRESS [SIZE]`, with the size in decimal. `I` is an
+// instruction fetch, which is a read unless a split I-cache is simulated.
+// A size outside [1, TRACE_MAX_SIZE] is an error that ends the program.
+//
+// This keeps the exact parsing behaviour of the original input loop
+// (scanf("%c %x\n")): a field that fails to parse keeps the value it had in
+// the previous record, so `record` must be reused between calls.
+bool trace_read(FILE *in, struct trace_record *record);
+
+// Returns "read", "write" or "fetch" for the verbose output.
+static inline const char *trace_access_name(char rw)
+{
+    return rw == 'W' ? "write" : rw == 'I' ? "fetch" : "read";
+}
+
+// Splitting accesses at line boundaries
+// ============================================================================
+// An access whose bytes span several cache lines is simulated as one access
+// per line. The splitter reads the records and returns the line accesses.
+
+#define TRACE_SIZE_BUCKETS 8
+
+struct trace_splitter {
+    struct trace_record whole;  // The record being split, as it was read.
+    struct trace_record record; // What is left of it.
+    uint32_t remaining;         // Its bytes not returned yet.
+    bool first;                 // Whether the last line access started its record.
+
+    bool sized;              // Whether any record had a size other than 1.
+    uint64_t records;        // Records read
+    uint64_t crossing;       // Records that crossed a line boundary
+    uint64_t line_accesses;  // Line accesses returned
+    uint64_t bytes;          // Bytes accessed
+    // Line accesses by bytes touched: [1], [2, 3], [4, 7], ...
+    uint64_t line_bytes[TRACE_SIZE_BUCKETS];
+};
+
+void trace_splitter_init(struct trace_splitter *sp);
+
+// Return the next line access in `access`. Returns false at the end.
+bool trace_split_next(struct trace_splitter *sp, FILE *in,
+                      bool (*read_record)(FILE *, struct trace_record *),
+                      struct cache_system *cache_system, struct trace_record *access);
+
+// For records that are not read from a stream: start splitting `record`, then
+// take its line accesses until trace_splitter_take returns false.
+void trace_splitter_feed(struct trace_splitter *sp, struct cache_system *cache_system,
+                         const struct trace_record *record);
+bool trace_splitter_take(struct trace_splitter *sp, struct cache_system *cache_system,
+                         struct trace_record *access);
+
+// Add the statistics of `other` to those of `sp`.
+void trace_splitter_merge(struct trace_splitter *sp, const struct trace_splitter *other);
+
+// Print the access size statistics, if the trace had any sizes.
+void trace_splitter_print(struct trace_splitter *sp);
+
+// Filtered traces
+// ============================================================================
+// A filtered trace is the stream of requests that an upper-level cache sends
+// below it: a read for every miss, and a write for every dirty eviction. It
+// is stored in binary (host byte order) as a header followed by records.
+
+#define FILTERED_TRACE_MAGIC "CSIMFLT1"
+
+struct filtered_trace_header {
+    char magic[8];
+    // The configuration of the cache that filtered the trace.
+    uint32_t cache_size, cache_lines, associativity;
+    char policy[36];
+    uint64_t accesses; // The number of line accesses in the original trace.
+    uint64_t records;  // The number of records in this file.
+};
+
+struct filtered_trace_record {
+    uint32_t address;
+    char rw;
+    char padding[3];
+};
+
+// Read and check the header of a filtered trace. Returns false if the file
+// is not a filtered trace.
+bool trace_filtered_read_header(FILE *in, struct filtered_trace_header *header);
+
+// Read the next record of a filtered trace. Returns false at the end.
+bool trace_filtered_read(FILE *in, struct trace_record *record);
+
+// A run of consecutive accesses to the same cache line.
+struct trace_run {
+    uint32_t line_addr; // The line address (address / line size).
+    uint32_t count;     // The number of accesses in the run.
+    bool write;         // Whether any access in the run is a write.
+};
+
+struct trace_runs {
+    struct trace_run *runs;
+    size_t count, capacity;
+    size_t accesses; // The number of line accesses in the original trace.
+};
+
+// Read a whole trace, split into line accesses by `sp`, and collapse
+// consecutive accesses to the same line of the given cache into runs.
+struct trace_runs *trace_runs_collapse(struct trace_splitter *sp, FILE *in,
+                                       struct cache_system *cache_system);
+void trace_runs_cleanup(struct trace_runs *runs);
+
+#endif
@@ -0,0 +1,63 @@
+//
+// This file contains the implementations for the functions defined in
+// way_predictor.h.
+//
+
+#include "way_predictor.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+struct way_predictor *way_predictor_new(uint32_t sets, uint32_t associativity,
+                                        enum way_predictor_mode mode, uint32_t penalty)
+{
+    struct way_predictor *wp = calloc(1, sizeof(struct way_predictor));
+    wp->mode = mode;
+    wp->associativity = associativity;
+    wp->penalty = penalty;
+    size_t entries = mode == WAY_PREDICT_MRU ? 1 : WAY_PREDICTOR_HASH_ENTRIES;
+    wp->table = calloc((size_t)sets * entries, sizeof(uint32_t));
+    return wp;
+}
+
+void way_predictor_cleanup(struct way_predictor *wp)
+{
+    free(wp->table);
+}
+
+void way_predictor_access(struct way_predictor *wp, uint32_t set_idx, uint32_t tag, bool hit,
+                          uint32_t way)
+{
+    uint32_t *entry = way_predictor_entry(wp, set_idx, tag);
+    if (!hit) {
+        // The tags of every way are compared to find out that it is a miss.
+        wp->stats.misses++;
+        wp->stats.ways_read += wp->associativity;
+    } else if (*entry == way) {
+        wp->stats.hits++;
+        wp->stats.correct++;
+        wp->stats.ways_read++;
+    } else {
+        wp->stats.hits++;
+        wp->stats.ways_read += wp->associativity;
+    }
+    *entry = way;
+}
+
+void way_predictor_bypass(struct way_predictor *wp)
+{
+    wp->stats.misses++;
+    wp->stats.ways_read += wp->associativity;
+}
+
+void way_predictor_print(struct way_predictor *wp)
+{
+    struct way_predictor_stats *s = &wp->stats;
+    uint64_t mispredictions = s->hits - s->correct;
+    uint64_t accesses = s->hits + s->misses;
+    printf("OUTPUT WAY PREDICTION HITS %" PRIu64 "\n", s->hits);
+    printf("OUTPUT WAY PREDICTION CORRECT %" PRIu64 "\n", s->correct);
+    printf("OUTPUT WAY PREDICTION ACCURACY %.8f\n", s->hits ? (double)s->correct / s->hits : 0.0);
+    printf("OUTPUT WAY PREDICTION PENALTY CYCLES %" PRIu64 "\n", mispredictions * wp->penalty);
+    printf("OUTPUT WAY PREDICTION WAYS READ PER ACCESS %.4f (OF %u)\n",
+           accesses ? (double)s->ways_read / accesses : 0.0, wp->associativity);
+}
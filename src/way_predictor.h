@@ -0,0 +1,72 @@
+//
+// This file defines the struct and function signatures for the way
+// predictor. For every access, the predictor names the way of the set that
+// is read first: the most recently used way of the set (MRU mode), or the
+// way last seen for the same hash of the tag (hash mode). A hit in the
+// predicted way only reads one way; any other hit is a misprediction that
+// reads the remaining ways in a second, slower probe.
+//
+// The simulator checks the predicted way before scanning the set, so that
+// correct predictions also shorten its own lookups.
+//
+
+#ifndef WAY_PREDICTOR_H
+#define WAY_PREDICTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// The number of predictor entries per set in hash mode.
+#define WAY_PREDICTOR_HASH_ENTRIES 8
+
+enum way_predictor_mode {
+    WAY_PREDICT_MRU,
+    WAY_PREDICT_HASH,
+};
+
+// Statistics about the way predictor.
+struct way_predictor_stats {
+    uint64_t hits;      // Hits, the accesses whose prediction matters
+    uint64_t correct;   // Hits in the predicted way
+    uint64_t misses;    // Misses, which read every way anyway
+    uint64_t ways_read; // Ways read by all of the probes
+};
+
+struct way_predictor {
+    struct way_predictor_stats stats;
+
+    enum way_predictor_mode mode;
+    uint32_t associativity;
+    uint32_t penalty; // Extra cycles of a misprediction
+
+    // The predicted way of every set (MRU), or of every hash of every set.
+    uint32_t *table;
+};
+
+struct way_predictor *way_predictor_new(uint32_t sets, uint32_t associativity,
+                                        enum way_predictor_mode mode, uint32_t penalty);
+void way_predictor_cleanup(struct way_predictor *wp);
+
+// Returns the entry of the table that predicts the way for the given tag.
+static inline uint32_t *way_predictor_entry(struct way_predictor *wp, uint32_t set_idx,
+                                            uint32_t tag)
+{
+    if (wp->mode == WAY_PREDICT_MRU) return &wp->table[set_idx];
+    uint32_t h = tag * 0x9e3779b1u;
+    return &wp->table[(size_t)set_idx * WAY_PREDICTOR_HASH_ENTRIES +
+                      (h >> 16) % WAY_PREDICTOR_HASH_ENTRIES];
+}
+
+// Called after every access with its outcome and the way that was accessed
+// (or filled), to score the prediction and train the predictor.
+void way_predictor_access(struct way_predictor *wp, uint32_t set_idx, uint32_t tag, bool hit,
+                          uint32_t way);
+
+// Called for a miss that bypasses the cache, which reads every way but
+// leaves the predictor untrained.
+void way_predictor_bypass(struct way_predictor *wp);
+
+void way_predictor_print(struct way_predictor *wp);
+
+#endif